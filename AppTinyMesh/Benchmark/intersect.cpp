@@ -0,0 +1,77 @@
+// Benchmark of the ray-triangle intersection kernels
+
+#include "trianglepacket.h"
+#include "timer.h"
+
+#include <algorithm>
+#include <random>
+
+/*!
+\brief Compare Triangle::Intersect() with TrianglePacket::Intersect() on random triangles and rays.
+
+Both kernels test every ray against every triangle and must report the same number of intersections.
+*/
+int main(int argc, char *argv[]) {
+    const int nt = argc > 1 ? atoi(argv[1]) : 4096;
+    const int nr = argc > 2 ? atoi(argv[2]) : 4096;
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    auto random = [&]() { return Vector(uniform(generator), uniform(generator), uniform(generator)); };
+
+    std::vector<Triangle> triangles;
+    triangles.reserve(nt);
+    for (int i = 0; i < nt; i++) {
+        Vector c = 4.0 * random();
+        triangles.emplace_back(c + 0.2 * random(), c + 0.2 * random(), c + 0.2 * random());
+    }
+
+    std::vector<TrianglePacket> packets;
+    for (int i = 0; i < nt; i += TrianglePacket::Size) {
+        packets.emplace_back(triangles.data() + i, std::min(TrianglePacket::Size, nt - i));
+    }
+
+    std::vector<Ray> rays;
+    rays.reserve(nr);
+    for (int i = 0; i < nr; i++) {
+        rays.emplace_back(4.0 * random(), Normalized(random()));
+    }
+
+    Timer timer;
+
+    // Scalar
+    int scalarHits = 0;
+    timer.Start();
+    for (const Ray &ray: rays) {
+        for (const Triangle &triangle: triangles) {
+            double t, u, v;
+            if (triangle.Intersect(ray, t, u, v) && t > 0.0) {
+                scalarHits++;
+            }
+        }
+    }
+    timer.Stop();
+    const double scalar = timer.ElapsedNanoSeconds() / (double(nt) * nr);
+
+    // Packets
+    int packetHits = 0;
+    timer.Start();
+    for (const Ray &ray: rays) {
+        for (const TrianglePacket &packet: packets) {
+            double t[TrianglePacket::Size], u[TrianglePacket::Size], v[TrianglePacket::Size];
+            int hits = packet.Intersect(ray, 0.0, 1.0e30, t, u, v);
+            for (; hits != 0; hits &= hits - 1) {
+                packetHits++;
+            }
+        }
+    }
+    timer.Stop();
+    const double packet = timer.ElapsedNanoSeconds() / (double(nt) * nr);
+
+    std::cout << "Triangles: " << nt << ", rays: " << nr << std::endl;
+    std::cout << "Triangle::Intersect       " << scalar << " ns per test, " << scalarHits << " hits" << std::endl;
+    std::cout << "TrianglePacket::Intersect " << packet << " ns per test, " << packetHits << " hits" << std::endl;
+    std::cout << "Speedup: " << scalar / packet << std::endl;
+
+    return scalarHits == packetHits ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+// Mesh adjacency
+
+#pragma once
+
+#include <vector>
+
+class Adjacency {
+protected:
+    int triangles = 0;               //!< Number of triangles.
+    std::vector<int> faceOffset;     //!< First entry of every vertex in the incident triangle array, and its size as last entry.
+    std::vector<int> faces;          //!< Incident triangles of every vertex, in increasing order.
+    std::vector<int> neighborOffset; //!< First entry of every vertex in the neighbor array, and its size as last entry.
+    std::vector<int> neighbors;      //!< Vertexes sharing an edge with every vertex.
+    std::vector<int> twins;          //!< Opposite half-edge of every half-edge, -1 on boundary and non-manifold edges.
+public:
+    //! Empty.
+    Adjacency() {}
+
+    explicit Adjacency(int, const std::vector<int> &);
+
+    //! Empty.
+    ~Adjacency() {}
+
+    int Vertexes() const;
+
+    int Triangles() const;
+
+    int Faces(int) const;
+
+    int Face(int, int) const;
+
+    const int *FaceData(int) const;
+
+    int Neighbors(int) const;
+
+    int Neighbor(int, int) const;
+
+    const int *NeighborData(int) const;
+
+    int Twin(int) const;
+
+    bool IsBoundary(int) const;
+};
+
+/*!
+\brief Return the number of vertexes.
+*/
+inline int Adjacency::Vertexes() const {
+    return faceOffset.empty() ? 0 : int(faceOffset.size()) - 1;
+}
+
+/*!
+\brief Return the number of triangles.
+*/
+inline int Adjacency::Triangles() const {
+    return triangles;
+}
+
+/*!
+\brief Return the number of triangles incident to a vertex.
+\param v Vertex index.
+*/
+inline int Adjacency::Faces(int v) const {
+    return faceOffset[v + 1] - faceOffset[v];
+}
+
+/*!
+\brief Return a triangle incident to a vertex.
+\param v Vertex index.
+\param k Index of the triangle, between 0 and Faces(v) excluded.
+*/
+inline int Adjacency::Face(int v, int k) const {
+    return faces[faceOffset[v] + k];
+}
+
+/*!
+\brief Return the triangles incident to a vertex, as a contiguous array of Faces(v) indexes.
+\param v Vertex index.
+*/
+inline const int *Adjacency::FaceData(int v) const {
+    return faces.data() + faceOffset[v];
+}
+
+/*!
+\brief Return the number of vertexes sharing an edge with a vertex.
+\param v Vertex index.
+*/
+inline int Adjacency::Neighbors(int v) const {
+    return neighborOffset[v + 1] - neighborOffset[v];
+}
+
+/*!
+\brief Return a vertex sharing an edge with a vertex.
+\param v Vertex index.
+\param k Index of the neighbor, between 0 and Neighbors(v) excluded.
+*/
+inline int Adjacency::Neighbor(int v, int k) const {
+    return neighbors[neighborOffset[v] + k];
+}
+
+/*!
+\brief Return the vertexes sharing an edge with a vertex, as a contiguous array of Neighbors(v) indexes.
+\param v Vertex index.
+*/
+inline const int *Adjacency::NeighborData(int v) const {
+    return neighbors.data() + neighborOffset[v];
+}
+
+/*!
+\brief Return the opposite half-edge.
+
+The half-edge 3t+i of triangle t goes from its vertex i to its vertex (i+1)%3.
+
+\param h Half-edge.
+\return The half-edge of the adjacent triangle going the other way, -1 if there is none or if the edge is non-manifold.
+*/
+inline int Adjacency::Twin(int h) const {
+    return twins[h];
+}
+
+/*!
+\brief Check whether a half-edge has no opposite half-edge.
+\param h Half-edge.
+*/
+inline bool Adjacency::IsBoundary(int h) const {
+    return twins[h] == -1;
+}
@@ -0,0 +1,61 @@
+// Progressive ambient occlusion
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "color.h"
+#include "mesh.h"
+#include "sampling.h"
+
+class AOBaker {
+protected:
+    std::thread thread;              //!< Worker thread.
+    std::atomic<bool> cancel{false}; //!< Cancellation flag, checked by the worker between vertices.
+    std::atomic<bool> running{false};//!< Whether the worker is still refining.
+
+    mutable std::mutex mutex;        //!< Protects the published buffer.
+    std::vector<Color> published;    //!< Last published ambient occlusion, one color per vertex.
+    int rays = 0;                    //!< Number of rays per vertex of the published buffer.
+    bool fresh = false;              //!< Whether the published buffer was not polled yet.
+public:
+    //! Empty.
+    AOBaker() {}
+
+    ~AOBaker();
+
+    AOBaker(const AOBaker &) = delete;
+
+    AOBaker &operator=(const AOBaker &) = delete;
+
+    void Start(const Mesh &, const std::vector<int> &, double,
+               HemisphereSampling = HemisphereSampling::LowDiscrepancy);
+
+    void Cancel();
+
+    bool Poll(std::vector<Color> &, int &);
+
+    bool Running() const;
+
+    static std::vector<int> Passes(int);
+
+    static int Occlusion(const Intersectable &, const Vector &, const Vector &, const HemisphereSampler &, double);
+
+protected:
+    void Run(const Mesh &, const std::vector<int> &, double, HemisphereSampling);
+
+protected:
+    static const double bias; //!< Offset of the origin of the rays along the normal.
+};
+
+/*!
+\brief Check whether the worker is still refining the ambient occlusion.
+
+A buffer may still be waiting to be polled when the worker is done.
+*/
+inline bool AOBaker::Running() const {
+    return running;
+}
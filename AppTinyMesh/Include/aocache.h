@@ -0,0 +1,36 @@
+// Ambient occlusion cache
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "color.h"
+#include "mesh.h"
+#include "sampling.h"
+
+class AOCache {
+protected:
+    std::string directory; //!< Directory of the cache files.
+public:
+    explicit AOCache(const std::string & = "AOCache");
+
+    //! Empty.
+    ~AOCache() {}
+
+    bool Load(std::uint64_t, int, std::vector<Color> &) const;
+
+    bool Save(std::uint64_t, const std::vector<Color> &) const;
+
+    void Clear() const;
+
+    static std::uint64_t Key(const Mesh &, int, double, HemisphereSampling);
+
+protected:
+    std::string File(std::uint64_t) const;
+
+protected:
+    static const char magic[4];   //!< Signature of cache files.
+    static const int version;     //!< Version of the file format.
+};
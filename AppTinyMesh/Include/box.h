@@ -56,6 +56,11 @@ public:
 
     double Area() const;
 
+    Box GetBox() const override;
+
+    double SignedDistance(const Vector &) const override;
+    double SignedDistanceGradient(const Vector &, Vector &) const override;
+
     // Compute sub-box
     Box Sub(int) const;
 
@@ -68,6 +73,11 @@ public:
 
     bool Intersect(const Ray &ray, double &d, double &d1, double &d2) const override;
 
+    bool Occluded(const Ray &, double, double) const override;
+
+protected:
+    bool Slab(const Ray &, double &, double &) const;
+
 
 public:
     static const double epsilon; //!< Internal \htmlonly\epsilon;\endhtmlonly for ray intersection tests.
@@ -141,6 +151,13 @@ inline double Box::Area() const {
     return 2.0 * (side[0] * side[1] + side[0] * side[2] + side[1] * side[2]);
 }
 
+/*!
+\brief Return the box itself, which is its own bounding box.
+*/
+inline Box Box::GetBox() const {
+    return *this;
+}
+
 /*!
 \brief Check if an argument box is inside the box.
 \param box The box.
@@ -173,40 +190,61 @@ inline int operator!=(const Box &a, const Box &b) {
     return !(a == b);
 }
 
-inline bool Box::Intersect(const Ray &ray, double &d, double &d1, double &d2) const {
+/*!
+\brief Compute the entry and exit depths of the line supporting a ray.
+\param ray The ray.
+\param tmin, tmax Returned depths, possibly negative.
+*/
+inline bool Box::Slab(const Ray &ray, double &tmin, double &tmax) const {
+    const Vector o = ray.Origin();
+    const Vector inv = ray.Direction().Inverse();
 
-    double tmin = (a[0] - ray.Origin()[0]) / ray.Direction()[0];
-    double tmax = (b[0] - ray.Origin()[0]) / ray.Direction()[0];
+    tmin = (a[0] - o[0]) * inv[0];
+    tmax = (b[0] - o[0]) * inv[0];
 
     if (tmin > tmax) std::swap(tmin, tmax);
 
-    double tymin = (a[1] - ray.Origin()[1]) / ray.Direction()[1];
-    double tymax = (b[1] - ray.Origin()[1]) / ray.Direction()[1];
-
-    if (tymin > tymax) std::swap(tymin, tymax);
+    for (int i = 1; i < 3; i++) {
+        double ta = (a[i] - o[i]) * inv[i];
+        double tb = (b[i] - o[i]) * inv[i];
 
-    if ((tmin > tymax) || (tymin > tmax))
-        return false;
-
-    if (tymin > tmin)
-        tmin = tymin;
+        if (ta > tb) std::swap(ta, tb);
 
-    if (tymax < tmax)
-        tmax = tymax;
+        if ((tmin > tb) || (ta > tmax))
+            return false;
 
-    float tzmin = (a[2] - ray.Origin()[2]) / ray.Direction()[2];
-    float tzmax = (b[2] - ray.Origin()[2]) / ray.Direction()[2];
+        if (ta > tmin)
+            tmin = ta;
 
-    if (tzmin > tzmax) std::swap(tzmin, tzmax);
+        if (tb < tmax)
+            tmax = tb;
+    }
+    return true;
+}
 
-    if ((tmin > tzmax) || (tzmin > tmax))
+/*!
+\brief Compute the intersection between a ray and the box.
+\param ray The ray.
+\param d Depth of the first intersection, 0 if the origin of the ray is inside the box.
+\param d1, d2 Entry and exit depths, the entry depth is negative if the origin of the ray is inside the box.
+*/
+inline bool Box::Intersect(const Ray &ray, double &d, double &d1, double &d2) const {
+    if (!Slab(ray, d1, d2) || d2 < 0.0)
         return false;
 
-    if (tzmin > tmin)
-        tmin = tzmin;
+    d = d1 > 0.0 ? d1 : 0.0;
+    return true;
+}
 
-    if (tzmax < tmax)
-        tmax = tzmax;
+/*!
+\brief Check whether the faces of the box are hit inside an interval.
+\param ray The ray.
+\param tmin, tmax Interval.
+*/
+inline bool Box::Occluded(const Ray &ray, double tmin, double tmax) const {
+    double t0, t1;
+    if (!Slab(ray, t0, t1))
+        return false;
 
-    return true;
+    return (t0 > tmin && t0 < tmax) || (t1 > tmin && t1 < tmax);
 }
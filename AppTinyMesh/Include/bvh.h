@@ -0,0 +1,64 @@
+// Bounding volume hierarchy
+
+#pragma once
+
+#include <vector>
+
+#include "trianglepacket.h"
+
+class BVH : public Intersectable {
+public:
+    //! Node of the flattened hierarchy.
+    struct Node {
+        Vector a, b; //!< Lower and upper vertex of the bounding box.
+        int offset;  //!< Index of the triangle packet for a leaf, index of the second child for an inner node.
+        int count;   //!< Number of triangles for a leaf, 0 for an inner node.
+        int axis;    //!< Split axis of an inner node.
+    };
+
+protected:
+    std::vector<Node> nodes;         //!< Nodes, the first child of an inner node is stored right after it.
+    std::vector<TrianglePacket> packets; //!< Triangles of every leaf.
+    std::vector<int> indexes;            //!< Index of the triangles in the original mesh, TrianglePacket::Size per leaf.
+public:
+    //! Empty.
+    BVH() {}
+
+    explicit BVH(const Mesh &);
+
+    //! Empty.
+    ~BVH() {}
+
+    bool Intersect(const Ray &, double &, double &, double &) const override;
+
+    bool Intersect(const Ray &, double &, double &, double &, int &) const;
+
+    bool Occluded(const Ray &, double, double) const override;
+
+    int Nodes() const;
+
+    int Packets() const;
+
+protected:
+    int Build(std::vector<int> &, const std::vector<Box> &, const std::vector<Vector> &, int, int, int);
+
+    static bool Slab(const Node &, const Vector &, const Vector &, double, double);
+
+protected:
+    static const int bins;     //!< Number of bins used to evaluate the surface area heuristic.
+    static const int depth;    //!< Depth after which nodes are split at the median, which bounds the traversal stack.
+};
+
+/*!
+\brief Return the number of nodes of the hierarchy.
+*/
+inline int BVH::Nodes() const {
+    return int(nodes.size());
+}
+
+/*!
+\brief Return the number of triangle packets stored in the leaves of the hierarchy.
+*/
+inline int BVH::Packets() const {
+    return int(packets.size());
+}
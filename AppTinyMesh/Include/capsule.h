@@ -17,4 +17,10 @@ public:
     bool IsInside(const Vector &p) const override;
 
     double Volume() const override;
+
+    Box GetBox() const override;
+
+    double SignedDistance(const Vector &p) const override;
+
+    double SignedDistanceGradient(const Vector &p, Vector &g) const override;
 };
\ No newline at end of file
@@ -27,11 +27,20 @@ public:
 
     void Scale(double x) override;
 
+    Box GetBox() const override;
+
+    double SignedDistance(const Vector &p) const override;
+
+    double SignedDistanceGradient(const Vector &p, Vector &g) const override;
+
     const Vector &getC() const;
 
     double getR() const;
 
     double getH() const;
+
+protected:
+    bool Interval(const Ray &ray, double &t0, double &t1) const;
 };
 
 
@@ -0,0 +1,74 @@
+// Disk tree
+
+#pragma once
+
+#include <vector>
+
+#include "mesh.h"
+
+class DiskTree {
+public:
+    //! Oriented disk standing for the surface around a vertex.
+    struct Disk {
+        Vector p;             //!< Center.
+        Vector n;             //!< Unit normal.
+        double area;          //!< Area.
+        double accessibility; //!< Fraction of the disk that is not occluded, which scales its own occlusion.
+    };
+
+    //! Node of the flattened hierarchy, which also stands for all the disks below it.
+    struct Node {
+        Vector a, b;          //!< Lower and upper vertex of the bounding box of the centers.
+        Vector p;             //!< Area weighted center of the disks.
+        Vector n;             //!< Area weighted mean of the normals, shorter than unit when they disagree.
+        double area;          //!< Total area.
+        double accessibility; //!< Area weighted mean accessibility.
+        double radius;        //!< Radius of the sphere centered at p enclosing all disks.
+        int offset;           //!< Index of the first disk for a leaf, index of the second child for an inner node.
+        int count;            //!< Number of disks for a leaf, 0 for an inner node.
+    };
+
+protected:
+    std::vector<Disk> disks;  //!< Disks, sorted by leaf.
+    std::vector<int> indexes; //!< Index of the vertex of every disk.
+    std::vector<int> slots;   //!< Index of the disk of every vertex.
+    std::vector<Node> nodes;  //!< Nodes, the first child of an inner node is stored right after it.
+public:
+    explicit DiskTree(const Mesh &);
+
+    //! Empty.
+    ~DiskTree() {}
+
+    double Occlusion(int, double, double) const;
+
+    void SetAccessibility(const std::vector<double> &);
+
+    int Disks() const;
+
+    int Nodes() const;
+
+protected:
+    int Build(int, int);
+
+    void Update(int);
+
+    static double FormFactor(const Vector &, const Vector &, const Vector &, const Vector &, double);
+
+protected:
+    static const int leaf;     //!< Maximum number of disks in a leaf.
+    static const double bias;  //!< Offset of the receivers along their normal.
+};
+
+/*!
+\brief Return the number of disks, which is the number of vertices of the mesh.
+*/
+inline int DiskTree::Disks() const {
+    return int(disks.size());
+}
+
+/*!
+\brief Return the number of nodes of the hierarchy.
+*/
+inline int DiskTree::Nodes() const {
+    return int(nodes.size());
+}
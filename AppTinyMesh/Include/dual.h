@@ -0,0 +1,218 @@
+// Dual numbers
+
+#pragma once
+
+#include <cmath>
+
+#include "mathematics.h"
+
+/*!
+\class Dual dual.h
+\brief Dual number carrying a value and its partial derivatives with respect to the three coordinates of a point.
+
+Evaluating a function written as a template over its scalar type with dual numbers computes its gradient
+exactly with a single evaluation, which is forward mode automatic differentiation.
+
+\code
+template<typename Real>
+Real f(const Real& x, const Real& y, const Real& z) { return sqrt(x * x + y * y + z * z) - 1.0; }
+
+Dual<double> r = f(Dual<double>(p[0], 0), Dual<double>(p[1], 1), Dual<double>(p[2], 2));
+Vector g = r.Gradient();
+\endcode
+*/
+template<typename Real>
+class Dual {
+public:
+    Real v;    //!< Value.
+    Real d[3]; //!< Partial derivatives.
+public:
+    //! Empty.
+    Dual() {}
+
+    Dual(Real);
+
+    Dual(Real, int);
+
+    Dual(Real, Real, Real, Real);
+
+    Vector Gradient() const;
+
+    Dual &operator+=(const Dual &);
+
+    Dual &operator-=(const Dual &);
+
+    Dual &operator*=(const Dual &);
+
+    Dual &operator/=(const Dual &);
+};
+
+/*!
+\brief Create a constant.
+\param x Value.
+*/
+template<typename Real>
+inline Dual<Real>::Dual(Real x) : v(x), d{Real(0), Real(0), Real(0)} {
+}
+
+/*!
+\brief Create one of the coordinates of the point with respect to which derivatives are computed.
+\param x Value.
+\param i Index of the coordinate.
+*/
+template<typename Real>
+inline Dual<Real>::Dual(Real x, int i) : v(x), d{Real(i == 0), Real(i == 1), Real(i == 2)} {
+}
+
+/*!
+\brief Create a dual number from its value and derivatives.
+\param x Value.
+\param dx, dy, dz Partial derivatives.
+*/
+template<typename Real>
+inline Dual<Real>::Dual(Real x, Real dx, Real dy, Real dz) : v(x), d{dx, dy, dz} {
+}
+
+//! Return the partial derivatives as a vector.
+template<typename Real>
+inline Vector Dual<Real>::Gradient() const {
+    return Vector(double(d[0]), double(d[1]), double(d[2]));
+}
+
+template<typename Real>
+inline Dual<Real> operator+(const Dual<Real> &a, const Dual<Real> &b) {
+    return Dual<Real>(a.v + b.v, a.d[0] + b.d[0], a.d[1] + b.d[1], a.d[2] + b.d[2]);
+}
+
+template<typename Real>
+inline Dual<Real> operator-(const Dual<Real> &a, const Dual<Real> &b) {
+    return Dual<Real>(a.v - b.v, a.d[0] - b.d[0], a.d[1] - b.d[1], a.d[2] - b.d[2]);
+}
+
+template<typename Real>
+inline Dual<Real> operator-(const Dual<Real> &a) {
+    return Dual<Real>(-a.v, -a.d[0], -a.d[1], -a.d[2]);
+}
+
+template<typename Real>
+inline Dual<Real> operator*(const Dual<Real> &a, const Dual<Real> &b) {
+    return Dual<Real>(a.v * b.v, a.d[0] * b.v + a.v * b.d[0], a.d[1] * b.v + a.v * b.d[1], a.d[2] * b.v + a.v * b.d[2]);
+}
+
+template<typename Real>
+inline Dual<Real> operator/(const Dual<Real> &a, const Dual<Real> &b) {
+    const Real s = Real(1) / (b.v * b.v);
+    return Dual<Real>(a.v / b.v, (a.d[0] * b.v - a.v * b.d[0]) * s, (a.d[1] * b.v - a.v * b.d[1]) * s,
+                      (a.d[2] * b.v - a.v * b.d[2]) * s);
+}
+
+// Mixed operators with constants, which would not be deduced from the conversion constructor
+template<typename Real>
+inline Dual<Real> operator+(const Dual<Real> &a, Real b) { return a + Dual<Real>(b); }
+
+template<typename Real>
+inline Dual<Real> operator+(Real a, const Dual<Real> &b) { return Dual<Real>(a) + b; }
+
+template<typename Real>
+inline Dual<Real> operator-(const Dual<Real> &a, Real b) { return a - Dual<Real>(b); }
+
+template<typename Real>
+inline Dual<Real> operator-(Real a, const Dual<Real> &b) { return Dual<Real>(a) - b; }
+
+template<typename Real>
+inline Dual<Real> operator*(const Dual<Real> &a, Real b) {
+    return Dual<Real>(a.v * b, a.d[0] * b, a.d[1] * b, a.d[2] * b);
+}
+
+template<typename Real>
+inline Dual<Real> operator*(Real a, const Dual<Real> &b) { return b * a; }
+
+template<typename Real>
+inline Dual<Real> operator/(const Dual<Real> &a, Real b) { return a * (Real(1) / b); }
+
+template<typename Real>
+inline Dual<Real> operator/(Real a, const Dual<Real> &b) { return Dual<Real>(a) / b; }
+
+template<typename Real>
+inline Dual<Real> &Dual<Real>::operator+=(const Dual<Real> &b) { return *this = *this + b; }
+
+template<typename Real>
+inline Dual<Real> &Dual<Real>::operator-=(const Dual<Real> &b) { return *this = *this - b; }
+
+template<typename Real>
+inline Dual<Real> &Dual<Real>::operator*=(const Dual<Real> &b) { return *this = *this * b; }
+
+template<typename Real>
+inline Dual<Real> &Dual<Real>::operator/=(const Dual<Real> &b) { return *this = *this / b; }
+
+// Comparisons only involve values
+template<typename Real>
+inline bool operator<(const Dual<Real> &a, const Dual<Real> &b) { return a.v < b.v; }
+
+template<typename Real>
+inline bool operator>(const Dual<Real> &a, const Dual<Real> &b) { return a.v > b.v; }
+
+template<typename Real>
+inline bool operator<(const Dual<Real> &a, Real b) { return a.v < b; }
+
+template<typename Real>
+inline bool operator>(const Dual<Real> &a, Real b) { return a.v > b; }
+
+//! Apply the chain rule to a function with value f and derivative df at the value of a.
+template<typename Real>
+inline Dual<Real> Chain(const Dual<Real> &a, Real f, Real df) {
+    return Dual<Real>(f, a.d[0] * df, a.d[1] * df, a.d[2] * df);
+}
+
+template<typename Real>
+inline Dual<Real> sqrt(const Dual<Real> &a) {
+    const Real s = std::sqrt(a.v);
+    return Chain(a, s, Real(0.5) / s);
+}
+
+template<typename Real>
+inline Dual<Real> fabs(const Dual<Real> &a) {
+    return a.v < Real(0) ? -a : a;
+}
+
+template<typename Real>
+inline Dual<Real> abs(const Dual<Real> &a) {
+    return fabs(a);
+}
+
+template<typename Real>
+inline Dual<Real> exp(const Dual<Real> &a) {
+    const Real e = std::exp(a.v);
+    return Chain(a, e, e);
+}
+
+template<typename Real>
+inline Dual<Real> log(const Dual<Real> &a) {
+    return Chain(a, std::log(a.v), Real(1) / a.v);
+}
+
+template<typename Real>
+inline Dual<Real> sin(const Dual<Real> &a) {
+    return Chain(a, std::sin(a.v), std::cos(a.v));
+}
+
+template<typename Real>
+inline Dual<Real> cos(const Dual<Real> &a) {
+    return Chain(a, std::cos(a.v), -std::sin(a.v));
+}
+
+template<typename Real>
+inline Dual<Real> pow(const Dual<Real> &a, Real e) {
+    const Real p = std::pow(a.v, e - Real(1));
+    return Chain(a, p * a.v, e * p);
+}
+
+template<typename Real>
+inline Dual<Real> min(const Dual<Real> &a, const Dual<Real> &b) {
+    return a.v < b.v ? a : b;
+}
+
+template<typename Real>
+inline Dual<Real> max(const Dual<Real> &a, const Dual<Real> &b) {
+    return a.v > b.v ? a : b;
+}
@@ -0,0 +1,59 @@
+// Dual contouring
+
+#pragma once
+
+#include <vector>
+
+#include "implicits.h"
+
+//! Quadratic error function measuring the squared distance to a set of tangent planes.
+class QEF {
+protected:
+    double ata[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0}; //!< Upper triangle of the symmetric matrix, stored as xx, xy, xz, yy, yz, zz.
+    double atb[3] = {0.0, 0.0, 0.0};                //!< Sum of the normals scaled by their offsets.
+    double btb = 0.0;                                //!< Sum of the squared offsets.
+    Vector mass = Vector::Null;                      //!< Sum of the points.
+    int count = 0;                                   //!< Number of planes.
+public:
+    //! Empty.
+    QEF() {}
+
+    void Add(const Vector &, const Vector &);
+
+    void Add(const QEF &);
+
+    int Count() const;
+
+    Vector Solve(const Box &) const;
+
+    double Error(const Vector &) const;
+
+protected:
+    static const double truncation; //!< Relative threshold under which eigenvalues are discarded.
+};
+
+class DualContouring {
+protected:
+    const AnalyticScalarField &field; //!< Scalar field.
+public:
+    explicit DualContouring(const AnalyticScalarField &);
+
+    //! Empty.
+    ~DualContouring() {}
+
+    void Polygonize(int, Mesh &, const Box &, double = 0.0, const double & = 1e-4) const;
+
+protected:
+    void Simplify(int, int, int, int, int, const std::vector<int> &, std::vector<QEF> &, const Vector &, const Vector &,
+                  double, std::vector<int> &, std::vector<Vector> &, QEF &, bool &) const;
+
+    void Cluster(int, int, int, int, int, const std::vector<int> &, const QEF &, const Vector &, const Vector &,
+                 std::vector<int> &, std::vector<Vector> &) const;
+};
+
+/*!
+\brief Return the number of planes.
+*/
+inline int QEF::Count() const {
+    return count;
+}
@@ -3,29 +3,226 @@
 #pragma once
 
 #include <iostream>
+#include <limits>
+#include <vector>
 
+#include "dual.h"
 #include "mesh.h"
 
+class TriangleSink;
+
+//! Root finding method used for computing vertices on straddling edges.
+enum class RootFinding {
+    Bisection = 0, //!< Bisection from the linear interpolation, one evaluation per halving of the interval.
+    Linear = 1,    //!< Linear interpolation of the values at the end vertices, no evaluation.
+    Illinois = 2,  //!< Regula falsi with the Illinois modification, superlinear convergence.
+    Newton = 3,    //!< Newton steps along the edge with the gradient, safeguarded by bisection.
+};
+
 class AnalyticScalarField {
+    friend class Polygonizer;
+    friend class DualContouring;
 protected:
+    RootFinding rootFinding = RootFinding::Bisection;  //!< Root finding method for vertices on straddling edges.
+    int budget = std::numeric_limits<int>::max();      //!< Maximum number of iterations of the root finding method, unbounded by default as Dichotomy().
+    mutable long long evaluations = 0;                 //!< Number of evaluations of the last polygonization.
 public:
     AnalyticScalarField();
 
     virtual double Value(const Vector &) const;
 
+    virtual void Values(const Vector *, double *, int) const;
+
     virtual Vector Gradient(const Vector &) const;
 
+    virtual int GradientCost() const;
+
     // Normal
     virtual Vector Normal(const Vector &) const;
 
     // Dichotomy
     Vector Dichotomy(Vector, Vector, double, double, double, const double & = 1.0e-4) const;
 
+    Vector Root(const Vector &, const Vector &, double, double, double, const double &, long long &) const;
+
+    void SetRootFinding(RootFinding, int = 16);
+
+    long long Evaluations() const;
+
     virtual void Polygonize(int, Mesh &, const Box &, const double & = 1e-4) const;
 
+    void PolygonizeSparse(int, Mesh &, const Box &, const double & = 1e-4) const;
+
+    void PolygonizeStream(int, TriangleSink &, const Box &, int = 16, const double & = 1e-4) const;
+
+    virtual double Lipschitz() const;
+
+protected:
+    //! Geometry of a slab of layers of cells, and scratch planes of the sweep, see Polygonize().
+    struct Slab {
+        std::vector<Vector> vertex; //!< Vertexes, except those on the lower plane when it is shared.
+        std::vector<Vector> normal; //!< Normals.
+        std::vector<int> triangle;  //!< Vertex indexes, negative for vertexes on the top plane of the previous slab.
+        int top = 0;                //!< Index of the first vertex on the top plane.
+        long long evaluations = 0;  //!< Number of evaluations.
+        int allocations = 0;        //!< Number of buffers that had to grow.
+
+        std::vector<double> a, b;              //!< Values on the lower and upper planes.
+        std::vector<Vector> u, v;              //!< Points of the lower and upper planes.
+        std::vector<int> eax, eay, ebx, eby;   //!< Vertexes on the edges of the lower and upper planes.
+        std::vector<int> ez;                   //!< Vertexes on the vertical edges.
+
+        void Clear();
+    };
+
+    void PolygonizeSlab(int, int, int, const Vector &, const Vector &, const std::vector<double> &, const double &, Slab &) const;
+
+    void SparseCells(int, const int[3], const int[3], const Vector &, const Vector &, double, std::vector<long long> &, long long &) const;
+
+    Vector CentralGradient(const Vector &) const;
+
 protected:
     static const double Epsilon; //!< Epsilon value for partial derivatives
 protected:
     static int TriangleTable[256][16]; //!< Two dimensionnal array storing the straddling edges for every marching cubes configuration.
     static int edgeTable[256];    //!< Array storing straddling edges for every marching cubes configuration.
 };
+
+class SphereField : public AnalyticScalarField {
+public:
+    Vector Gradient(const Vector &) const override;
+
+    int GradientCost() const override;
+};
+
+class Polygonizer {
+protected:
+    std::vector<AnalyticScalarField::Slab> slab; //!< Slabs, whose buffers are kept from one call to the next.
+    std::vector<double> z;                       //!< Heights of the planes.
+    std::vector<int> offset;                     //!< First vertex of every slab.
+    std::vector<int> start;                      //!< First triangle index of every slab.
+    int resolution = 0;                          //!< Discretization parameter of the last call.
+    int vertexes = 0;                            //!< Number of vertexes of the last call.
+    int triangles = 0;                           //!< Number of triangles of the last call.
+    int allocations = 0;                         //!< Number of buffers that had to grow during the last call.
+    long long total = 0;                         //!< Number of buffers that had to grow since creation.
+public:
+    //! Empty.
+    Polygonizer() {}
+
+    //! Empty.
+    ~Polygonizer() {}
+
+    void Polygonize(const AnalyticScalarField &, int, Mesh &, const Box &, const double & = 1e-4);
+
+    int Vertexes() const;
+
+    int Triangles() const;
+
+    int Allocations() const;
+
+    long long TotalAllocations() const;
+};
+
+/*!
+\brief Return the number of vertexes of the last polygonization.
+*/
+inline int Polygonizer::Vertexes() const {
+    return vertexes;
+}
+
+/*!
+\brief Return the number of triangles of the last polygonization.
+*/
+inline int Polygonizer::Triangles() const {
+    return triangles;
+}
+
+/*!
+\brief Return the number of scratch buffers that had to grow during the last polygonization.
+
+Buffers of the returned mesh are not counted. Repeating a polygonization at the same resolution does not allocate.
+*/
+inline int Polygonizer::Allocations() const {
+    return allocations;
+}
+
+/*!
+\brief Return the number of scratch buffers that had to grow since the creation of the polygonizer.
+*/
+inline long long Polygonizer::TotalAllocations() const {
+    return total;
+}
+
+/*!
+\brief Set the method used for computing vertices on straddling edges.
+
+By default, bisection is not bounded and yields the same vertices as Dichotomy(). A bounded bisection stops
+after the given number of halvings, so it only reaches the precision if the edge is shorter than epsilon times 2^iterations.
+
+\param method Root finding method.
+\param iterations Maximum number of iterations, which bounds the number of evaluations per edge.
+*/
+inline void AnalyticScalarField::SetRootFinding(RootFinding method, int iterations) {
+    rootFinding = method;
+    budget = iterations;
+}
+
+/*!
+\brief Return the number of field evaluations of the last polygonization.
+
+Evaluations of the grid and of the root finding method are counted, every gradient of a Newton step counts
+as GradientCost() evaluations. The normals at the vertexes of the mesh are not counted: they cost
+GradientCost() evaluations per vertex, for instance six per vertex with central differences.
+*/
+inline long long AnalyticScalarField::Evaluations() const {
+    return evaluations;
+}
+
+/*!
+\brief Scalar field whose gradient is computed exactly with dual numbers, from a single evaluation.
+
+The derived class defines its field once, as a template member function over the scalar type:
+\code
+class Blob : public AutoDiffScalarField<Blob> {
+public:
+    template<typename Real>
+    Real Field(const Real &x, const Real &y, const Real &z) const { return sqrt(x * x + y * y + z * z) - 1.0; }
+};
+\endcode
+*/
+template<typename Derived>
+class AutoDiffScalarField : public AnalyticScalarField {
+public:
+    double Value(const Vector &) const override;
+
+    Vector Gradient(const Vector &) const override;
+
+    int GradientCost() const override;
+};
+
+/*!
+\brief Compute the value of the field.
+\param p Point.
+*/
+template<typename Derived>
+inline double AutoDiffScalarField<Derived>::Value(const Vector &p) const {
+    return static_cast<const Derived *>(this)->Field(p[0], p[1], p[2]);
+}
+
+/*!
+\brief Compute the gradient of the field by evaluating it with dual numbers.
+\param p Point.
+*/
+template<typename Derived>
+inline Vector AutoDiffScalarField<Derived>::Gradient(const Vector &p) const {
+    return static_cast<const Derived *>(this)->Field(Dual<double>(p[0], 0), Dual<double>(p[1], 1), Dual<double>(p[2], 2)).Gradient();
+}
+
+/*!
+\brief Return the cost of the gradient, a single evaluation with dual numbers.
+*/
+template<typename Derived>
+inline int AutoDiffScalarField<Derived>::GradientCost() const {
+    return 1;
+}
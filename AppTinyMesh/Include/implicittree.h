@@ -0,0 +1,191 @@
+// Implicit modeling tree
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "box.h"
+#include "implicits.h"
+
+class ImplicitNode {
+protected:
+    Box box; //!< Bounding box of the surface.
+public:
+    explicit ImplicitNode(const Box &);
+
+    //! Empty.
+    virtual ~ImplicitNode() {}
+
+    virtual double Value(const Vector &) const = 0;
+
+    virtual double ValueGradient(const Vector &, Vector &) const = 0;
+
+    double Bounded(const Vector &, double = 0.0) const;
+
+    double BoundedGradient(const Vector &, Vector &, double = 0.0) const;
+
+    double Bound(const Vector &) const;
+
+    const Box &GetBox() const;
+};
+
+class ImplicitPrimitive : public ImplicitNode {
+protected:
+    std::shared_ptr<const Primitive> primitive; //!< Primitive, possibly shared.
+public:
+    explicit ImplicitPrimitive(const std::shared_ptr<const Primitive> &);
+
+    double Value(const Vector &) const override;
+
+    double ValueGradient(const Vector &, Vector &) const override;
+};
+
+class ImplicitOperator : public ImplicitNode {
+protected:
+    std::shared_ptr<const ImplicitNode> left;  //!< First operand.
+    std::shared_ptr<const ImplicitNode> right; //!< Second operand.
+public:
+    ImplicitOperator(const std::shared_ptr<const ImplicitNode> &, const std::shared_ptr<const ImplicitNode> &, const Box &);
+};
+
+class ImplicitUnion : public ImplicitOperator {
+public:
+    ImplicitUnion(const std::shared_ptr<const ImplicitNode> &, const std::shared_ptr<const ImplicitNode> &);
+
+    double Value(const Vector &) const override;
+
+    double ValueGradient(const Vector &, Vector &) const override;
+};
+
+class ImplicitIntersection : public ImplicitOperator {
+public:
+    ImplicitIntersection(const std::shared_ptr<const ImplicitNode> &, const std::shared_ptr<const ImplicitNode> &);
+
+    double Value(const Vector &) const override;
+
+    double ValueGradient(const Vector &, Vector &) const override;
+};
+
+class ImplicitDifference : public ImplicitOperator {
+public:
+    ImplicitDifference(const std::shared_ptr<const ImplicitNode> &, const std::shared_ptr<const ImplicitNode> &);
+
+    double Value(const Vector &) const override;
+
+    double ValueGradient(const Vector &, Vector &) const override;
+};
+
+class ImplicitBlend : public ImplicitOperator {
+protected:
+    double radius; //!< Radius of the blend.
+public:
+    ImplicitBlend(const std::shared_ptr<const ImplicitNode> &, const std::shared_ptr<const ImplicitNode> &, double);
+
+    double Value(const Vector &) const override;
+
+    double ValueGradient(const Vector &, Vector &) const override;
+};
+
+class ImplicitTransform : public ImplicitNode {
+protected:
+    std::shared_ptr<const ImplicitNode> node; //!< Transformed node.
+    Matrix inverse;     //!< Inverse of the rotation and scale.
+    Vector translation; //!< Translation, applied after the rotation and scale.
+    double scale;       //!< Uniform scale.
+public:
+    ImplicitTransform(const std::shared_ptr<const ImplicitNode> &, const Vector & = Vector::Null,
+                      const Matrix & = Matrix::Idendity, double = 1.0);
+
+    double Value(const Vector &) const override;
+
+    double ValueGradient(const Vector &, Vector &) const override;
+};
+
+class ImplicitTree : public AnalyticScalarField {
+protected:
+    std::shared_ptr<const ImplicitNode> root; //!< Root node.
+public:
+    explicit ImplicitTree(const std::shared_ptr<const ImplicitNode> &);
+
+    //! Empty.
+    ~ImplicitTree() {}
+
+    double Value(const Vector &) const override;
+
+    Vector Gradient(const Vector &) const override;
+
+    int GradientCost() const override;
+
+    double Lipschitz() const override;
+
+    const Box &GetBox() const;
+
+    static std::shared_ptr<const ImplicitNode> Union(const std::vector<std::shared_ptr<const ImplicitNode>> &);
+
+    static std::shared_ptr<const ImplicitNode> Blend(const std::vector<std::shared_ptr<const ImplicitNode>> &, double);
+
+protected:
+    static std::shared_ptr<const ImplicitNode> Balanced(std::vector<std::shared_ptr<const ImplicitNode>> &, int, int, double);
+};
+
+/*!
+\brief Create a node.
+\param box Bounding box of the surface of the node.
+*/
+inline ImplicitNode::ImplicitNode(const Box &box) : box(box) {
+}
+
+/*!
+\brief Return the bounding box of the surface of the node.
+*/
+inline const Box &ImplicitNode::GetBox() const {
+    return box;
+}
+
+/*!
+\brief Compute the distance from a point to the bounding box, which is a lower bound of its distance to the surface.
+\param p Point.
+\return The distance, 0 inside the box.
+*/
+inline double ImplicitNode::Bound(const Vector &p) const {
+    const Vector q = Vector::Max(Vector::Max(box[0] - p, p - box[1]), Vector::Null);
+    return Norm(q);
+}
+
+/*!
+\brief Compute the value of the field, or only a lower bound of the distance when the point is far from the box.
+
+The subtree is not evaluated when the point is farther than the margin from the box.
+
+\param p Point.
+\param margin Margin around the box.
+*/
+inline double ImplicitNode::Bounded(const Vector &p, double margin) const {
+    const double d = Bound(p);
+    return d > margin ? d : Value(p);
+}
+
+/*!
+\brief Compute the value and the gradient of the field, or of the distance to the box when the point is far from the box.
+\sa Bounded()
+\param p Point.
+\param g Returned gradient.
+\param margin Margin around the box.
+*/
+inline double ImplicitNode::BoundedGradient(const Vector &p, Vector &g, double margin) const {
+    const Vector q = Vector::Max(Vector::Max(box[0] - p, p - box[1]), Vector::Null);
+    const double d = Norm(q);
+    if (d > margin) {
+        g = Vector(p[0] < box[0][0] ? -q[0] : q[0], p[1] < box[0][1] ? -q[1] : q[1], p[2] < box[0][2] ? -q[2] : q[2]) / d;
+        return d;
+    }
+    return ValueGradient(p, g);
+}
+
+/*!
+\brief Return the bounding box of the surface.
+*/
+inline const Box &ImplicitTree::GetBox() const {
+    return root->GetBox();
+}
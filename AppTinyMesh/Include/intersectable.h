@@ -12,5 +12,12 @@ class Intersectable {
 public:
     virtual ~Intersectable()=default;
     virtual bool Intersect(const Ray &, double &, double &, double &) const = 0;
-};
 
+    /**
+     * Occlusion query, cheaper than Intersect as it may stop at the first intersection found
+     * @param ray ray
+     * @param tmin,tmax only intersections with a depth in ]tmin, tmax[ are considered
+     * @return true if the ray hits the object inside the interval
+     */
+    virtual bool Occluded(const Ray &ray, double tmin, double tmax) const = 0;
+};
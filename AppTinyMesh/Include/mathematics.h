@@ -9,6 +9,8 @@ public:
     static constexpr double Clamp(double, double = 0.0, double = 1.0);
 
     static constexpr double PI();
+
+    static constexpr double DifferenceStep();
     // Minimum and maximum
     static constexpr double Min(double, double);
 
@@ -100,6 +102,13 @@ constexpr double Math::PI() {
     return 3.14159265358979311599796346854;
 }
 
+/*!
+\brief Step of the central differences used for approximating derivatives.
+*/
+constexpr double Math::DifferenceStep() {
+    return 1.0e-6;
+}
+
 
 // Class
 class Vector {
@@ -511,7 +520,7 @@ public:
 
     double operator[](int) const;
 
-    Vector operator*(const Vector &);
+    Vector operator*(const Vector &) const;
 
     friend Matrix operator*(double, const Matrix &);
 
@@ -539,7 +548,7 @@ inline double Matrix::operator[](int i) const {
  * @param v
  * @return modified vector
  */
-inline Vector Matrix::operator*(const Vector &v) {
+inline Vector Matrix::operator*(const Vector &v) const {
     return Vector(c[0] * v[0] + c[1] * v[1] + c[2] * v[2],
                   c[3] * v[0] + c[4] * v[1] + c[5] * v[2],
                   c[6] * v[0] + c[7] * v[1] + c[8] * v[2]);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #include "box.h"
 #include "ray.h"
 #include "mathematics.h"
@@ -8,6 +10,8 @@
 #include "capsule.h"
 #include "torus.h"
 #include "intersectable.h"
+#include "adjacency.h"
+#include "view.h"
 
 // Triangle
 class Triangle : public Intersectable{
@@ -31,6 +35,8 @@ public:
     // Intersection
     bool Intersect(const Ray &, double &, double &, double &) const override;
 
+    bool Occluded(const Ray &, double, double) const override;
+
     void Translate(const Vector &);
 
     // Geometry
@@ -82,6 +88,15 @@ inline double Triangle::Area() const {
 inline Triangle::Triangle(const Vector &a, const Vector &b, const Vector &c) : p({a, b, c}) {}
 
 
+/*!
+\brief Triangle stored as plain coordinates, with precomputed edges, for intersection loops.
+*/
+struct FlatTriangle {
+    double v0[3]; //!< First vertex.
+    double e1[3]; //!< First edge, from the first to the second vertex.
+    double e2[3]; //!< Second edge, from the first to the third vertex.
+};
+
 class QString;
 
 class Mesh {
@@ -90,6 +105,9 @@ protected:
     std::vector<Vector> normals;  //!< Normals.
     std::vector<int> varray;     //!< Vertex indexes.
     std::vector<int> narray;     //!< Normal indexes.
+
+    mutable std::vector<FlatTriangle> flat; //!< Cached flat triangles, built on demand.
+    mutable Adjacency adjacency;            //!< Cached adjacency, built on demand.
 public:
     explicit Mesh();
 
@@ -104,6 +122,10 @@ public:
 
     Triangle GetTriangle(int) const;
 
+    const std::vector<FlatTriangle> &FlatTriangles() const;
+
+    const Adjacency &GetAdjacency() const;
+
     Vector Vertex(int) const;
 
     Vector Vertex(int, int) const;
@@ -118,6 +140,14 @@ public:
 
     std::vector<int> NormalIndexes() const;
 
+    View<int> VertexIndexView() const;
+
+    View<int> NormalIndexView() const;
+
+    const Vector *VertexData() const;
+
+    const Vector *NormalData() const;
+
     int VertexIndex(int, int) const;
 
     int NormalIndex(int, int) const;
@@ -126,6 +156,8 @@ public:
 
     Box GetBox() const;
 
+    std::uint64_t Hash() const;
+
     void ScaleUniform(double);
 
     void Scale(double, double, double);
@@ -136,7 +168,9 @@ public:
 
     void Rotate(double Angle, const Vector &Up);
 
-    void SmoothNormals();
+    void SmoothNormals(bool = false);
+
+    int Weld(double = 1.0e-6, double = 1.0e-6);
 
     // Constructors from core classes
     explicit Mesh(const Box &box);
@@ -155,6 +189,14 @@ public:
     virtual void DebugVertices();
 
 protected:
+    void Invalidate();
+
+    void InvalidateTopology();
+
+    static std::vector<Vector> Cluster(const std::vector<Vector> &, double, std::vector<int> &);
+
+    void BuildFlat() const;
+
     void AddTriangle(int, int, int, int);
 
     void AddSmoothTriangle(int, int, int, int, int, int);
@@ -178,6 +220,34 @@ inline std::vector<int> Mesh::NormalIndexes() const {
     return narray;
 }
 
+/*!
+\brief Return a read-only view of the vertex indexes, without copying them.
+*/
+inline View<int> Mesh::VertexIndexView() const {
+    return varray;
+}
+
+/*!
+\brief Return a read-only view of the normal indexes, without copying them.
+*/
+inline View<int> Mesh::NormalIndexView() const {
+    return narray;
+}
+
+/*!
+\brief Return a pointer to the contiguous array of Vertexes() vertices.
+*/
+inline const Vector *Mesh::VertexData() const {
+    return vertices.data();
+}
+
+/*!
+\brief Return a pointer to the contiguous array of normals.
+*/
+inline const Vector *Mesh::NormalData() const {
+    return normals.data();
+}
+
 /*!
 \brief Get the vertex index of a given triangle.
 \param t Triangle index.
@@ -206,6 +276,46 @@ inline Triangle Mesh::GetTriangle(int i) const {
                     vertices.at(varray.at(i * 3 + 2)));
 }
 
+/*!
+\brief Return the flat triangles of the mesh, built on the first call after the geometry was modified.
+
+The cache is not built in a thread-safe way: call this function once before sharing the mesh between threads.
+*/
+inline const std::vector<FlatTriangle> &Mesh::FlatTriangles() const {
+    if (flat.size() * 3 != varray.size()) {
+        BuildFlat();
+    }
+    return flat;
+}
+
+/*!
+\brief Return the adjacency of the mesh, built on the first call after the triangles were modified.
+
+Building takes linear time in the number of triangles. As FlatTriangles(), the cache is not built in a thread-safe
+way: call this function once before sharing the mesh between threads.
+*/
+inline const Adjacency &Mesh::GetAdjacency() const {
+    if (adjacency.Triangles() * 3 != int(varray.size()) || adjacency.Vertexes() != int(vertices.size())) {
+        adjacency = Adjacency(int(vertices.size()), varray);
+    }
+    return adjacency;
+}
+
+/*!
+\brief Discard the cached flat triangles, should be called by every function modifying the geometry.
+*/
+inline void Mesh::Invalidate() {
+    flat.clear();
+}
+
+/*!
+\brief Discard the cached flat triangles and adjacency, should be called by every function modifying the triangles.
+*/
+inline void Mesh::InvalidateTopology() {
+    Invalidate();
+    adjacency = Adjacency();
+}
+
 /*!
 \brief Get a vertex.
 \param i The index of the wanted vertex.
@@ -4,6 +4,9 @@
 #include <cassert>
 #include "color.h"
 #include "mesh.h"
+#include "sampling.h"
+
+class AOCache;
 
 class MeshColor : public Mesh {
 protected:
@@ -17,6 +20,8 @@ public:
 
     explicit MeshColor(const Mesh &);
 
+    explicit MeshColor(const Mesh &m, const std::vector<Color> &cols, const std::vector<int> &carr);
+
     explicit MeshColor(const Mesh &m, const std::vector<Color> &cols, const std::vector<int> &carr, int acc,
                        double range);
 
@@ -34,7 +39,27 @@ public:
 
     std::vector<int> AOIndexes() const;
 
-    void Accessibility(int accuracy, double range);
+    View<Color> ColorView() const;
+
+    View<int> ColorIndexView() const;
+
+    View<Color> AOView() const;
+
+    View<int> AOIndexView() const;
+
+    void SetAO(const std::vector<Color> &);
+
+    void Accessibility(int accuracy, double range, HemisphereSampling sampling = HemisphereSampling::Uniform);
+
+    void Accessibility(const Intersectable &occluder, int accuracy, double range,
+                       HemisphereSampling sampling = HemisphereSampling::Uniform);
+
+    void ApproximateAccessibility(double range, int passes = 1, double threshold = 2.0);
+
+    bool Accessibility(const AOCache &cache, int accuracy, double range,
+                       HemisphereSampling sampling = HemisphereSampling::Uniform);
+
+    static int Rays(int accuracy);
 };
 
 /*!
@@ -76,5 +101,40 @@ inline std::vector<int> MeshColor::AOIndexes() const {
     return aoarray;
 }
 
+/*!
+\brief Return a read-only view of the colors, without copying them.
+*/
+inline View<Color> MeshColor::ColorView() const {
+    return colors;
+}
+
+/*!
+\brief Return a read-only view of the color indexes, without copying them.
+*/
+inline View<int> MeshColor::ColorIndexView() const {
+    return carray;
+}
+
+/*!
+\brief Return a read-only view of the AO colors, without copying them.
+*/
+inline View<Color> MeshColor::AOView() const {
+    return aocolors;
+}
+
+/*!
+\brief Return a read-only view of the AO color indexes, without copying them.
+*/
+inline View<int> MeshColor::AOIndexView() const {
+    return aoarray;
+}
+
+/**
+ * @param accuracy Accuracy of the AO
+ * @return The number of rays per vertex used by Accessibility : 1+((accuracy*4-1)(accuracy^2)) if accuracy > 1, 1 otherwise
+ */
+inline int MeshColor::Rays(int accuracy) {
+    return accuracy <= 1 ? 1 : 1 + (accuracy * 4 - 1) * accuracy * accuracy;
+}
 
 #endif
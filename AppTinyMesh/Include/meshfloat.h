@@ -0,0 +1,128 @@
+// Single precision mesh
+
+#pragma once
+
+#include <vector>
+
+#include "mesh.h"
+
+class MeshFloat {
+protected:
+    std::vector<float> vertices; //!< Packed coordinates of the vertexes, three per vertex.
+    std::vector<float> normals;  //!< Packed coordinates of the normals, three per vertex.
+    std::vector<int> indexes;    //!< Vertex indexes, three per triangle, shared by vertexes and normals.
+public:
+    //! Empty.
+    MeshFloat() {}
+
+    explicit MeshFloat(const Mesh &);
+
+    //! Empty.
+    ~MeshFloat() {}
+
+    Mesh ToMesh() const;
+
+    int Vertexes() const;
+
+    int Triangles() const;
+
+    Vector Vertex(int) const;
+
+    Vector Normal(int) const;
+
+    int VertexIndex(int, int) const;
+
+    void SetVertex(int, const Vector &);
+
+    void SetNormal(int, const Vector &);
+
+    const float *VertexData() const;
+
+    const float *NormalData() const;
+
+    const int *IndexData() const;
+
+    Box GetBox() const;
+};
+
+/*!
+\brief Get the number of vertexes, which is also the number of normals.
+*/
+inline int MeshFloat::Vertexes() const {
+    return int(vertices.size()) / 3;
+}
+
+/*!
+\brief Get the number of triangles.
+*/
+inline int MeshFloat::Triangles() const {
+    return int(indexes.size()) / 3;
+}
+
+/*!
+\brief Get a vertex in double precision.
+\param i Index.
+*/
+inline Vector MeshFloat::Vertex(int i) const {
+    return Vector(vertices[3 * i], vertices[3 * i + 1], vertices[3 * i + 2]);
+}
+
+/*!
+\brief Get a normal in double precision.
+\param i Index.
+*/
+inline Vector MeshFloat::Normal(int i) const {
+    return Vector(normals[3 * i], normals[3 * i + 1], normals[3 * i + 2]);
+}
+
+/*!
+\brief Get the vertex index of a given triangle, which is also its normal index.
+\param t Triangle index.
+\param i Vertex of the triangle: 0, 1, or 2.
+*/
+inline int MeshFloat::VertexIndex(int t, int i) const {
+    return indexes[t * 3 + i];
+}
+
+/*!
+\brief Set a vertex, rounded to single precision.
+\param i Index.
+\param p Vertex.
+*/
+inline void MeshFloat::SetVertex(int i, const Vector &p) {
+    for (int k = 0; k < 3; k++) {
+        vertices[3 * i + k] = float(p[k]);
+    }
+}
+
+/*!
+\brief Set a normal, rounded to single precision.
+\param i Index.
+\param n Normal.
+*/
+inline void MeshFloat::SetNormal(int i, const Vector &n) {
+    for (int k = 0; k < 3; k++) {
+        normals[3 * i + k] = float(n[k]);
+    }
+}
+
+/*!
+\brief Return the packed coordinates of the vertexes, which may be uploaded as is to the GPU.
+*/
+inline const float *MeshFloat::VertexData() const {
+    return vertices.data();
+}
+
+/*!
+\brief Return the packed coordinates of the normals, which may be uploaded as is to the GPU.
+*/
+inline const float *MeshFloat::NormalData() const {
+    return normals.data();
+}
+
+/*!
+\brief Return the vertex indexes of the triangles, which may be uploaded as is to the GPU.
+*/
+inline const int *MeshFloat::IndexData() const {
+    return indexes.data();
+}
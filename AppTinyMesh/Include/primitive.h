@@ -7,6 +7,8 @@
 #include "mathematics.h"
 #include "intersectable.h"
 
+class Box;
+
 /**
  * Virtual class for primitive shapes
  */
@@ -25,5 +27,48 @@ public:
 
     virtual void Scale(double x) = 0;
 
+    /**
+     * @return axis aligned bounding box of the primitive
+     */
+    virtual Box GetBox() const = 0;
+
+    /**
+     * @param p point
+     * @return signed euclidean distance to the surface, negative inside
+     */
+    virtual double SignedDistance(const Vector &p) const = 0;
+
+    virtual double SignedDistanceGradient(const Vector &p, Vector &g) const;
+
     virtual bool Intersect(const Ray &ray, double &d, double &d1, double &d2) const = 0;
+
+    bool Occluded(const Ray &ray, double tmin, double tmax) const override;
 };
+
+/**
+ * Default signed distance gradient, with central differences of step Math::DifferenceStep()
+ *
+ * This costs 6 + 1 signed distance evaluations, six for the gradient and one for the returned distance.
+ * @param p point
+ * @param g returned gradient of the signed distance
+ * @return signed euclidean distance to the surface, negative inside
+ */
+inline double Primitive::SignedDistanceGradient(const Vector &p, Vector &g) const {
+    const double e = Math::DifferenceStep();
+    g = Vector(SignedDistance(p + Vector(e, 0.0, 0.0)) - SignedDistance(p - Vector(e, 0.0, 0.0)),
+               SignedDistance(p + Vector(0.0, e, 0.0)) - SignedDistance(p - Vector(0.0, e, 0.0)),
+               SignedDistance(p + Vector(0.0, 0.0, e)) - SignedDistance(p - Vector(0.0, 0.0, e))) * (0.5 / e);
+    return SignedDistance(p);
+}
+
+/**
+ * Default occlusion query, the surface is hit at the entry and exit points reported by Intersect
+ * @param ray ray
+ * @param tmin,tmax interval
+ * @return true if either the entry or the exit point lies inside ]tmin, tmax[
+ */
+inline bool Primitive::Occluded(const Ray &ray, double tmin, double tmax) const {
+    double d, d1, d2;
+    if (!Intersect(ray, d, d1, d2)) return false;
+    return (d1 > tmin && d1 < tmax) || (d2 > tmin && d2 < tmax);
+}
@@ -2,8 +2,11 @@
 #define __Qte__
 
 #include <QtWidgets/qmainwindow.h>
+#include <QtCore/qtimer.h>
 #include "realtime.h"
 #include "meshcolor.h"
+#include "aobaker.h"
+#include "aocache.h"
 
 QT_BEGIN_NAMESPACE
 	namespace Ui { class Assets; }
@@ -18,6 +21,12 @@ private:
   MeshWidget* meshWidget;   //!< Viewer
   MeshColor meshColor;		//!< Mesh.
 
+  AOBaker aoBaker;          //!< Background ambient occlusion of the mesh.
+  QTimer* aoTimer;          //!< Polls the ambient occlusion while it is refined.
+  AOCache aoCache;          //!< Ambient occlusion of previously generated meshes.
+  std::uint64_t aoKey = 0;  //!< Cache key of the ambient occlusion being refined.
+  int aoRays = 0;           //!< Number of rays of the last pass of the ambient occlusion being refined.
+
 public:
   MainWindow();
   ~MainWindow();
@@ -35,6 +44,7 @@ public slots:
   void TorusMeshExample();
   void ResetCamera();
   void UpdateMaterial();
+  void UpdateAO();
 };
 
 #endif
@@ -7,8 +7,12 @@
 
 #include "mesh.h"
 #include "meshcolor.h"
+#include "meshfloat.h"
+#include "trianglesink.h"
+#include "spheretracer.h"
 
 #include <QtCore/QMap>
+#include <QtGui/QImage>
 
 // Utility class for profiling CPU & GPU
 typedef std::chrono::time_point<std::chrono::high_resolution_clock> MyChrono;
@@ -82,6 +86,33 @@ enum class MeshShading {
     Lines = 1,
 };
 
+class GLBufferSink : public TriangleSink {
+protected:
+    GLuint vertexBuffer = 0;    //!< Interleaved vertexes and normals in single precision.
+    GLuint indexBuffer = 0;     //!< Vertex indexes of the triangles.
+    size_t vertexCapacity = 0;  //!< Capacity of the vertex buffer, in vertexes.
+    size_t indexCapacity = 0;   //!< Capacity of the index buffer, in indexes.
+    size_t vertexes = 0;        //!< Number of vertexes.
+    size_t indexes = 0;         //!< Number of indexes.
+    Vector lower, upper;        //!< Bounding box of the vertexes.
+    std::vector<float> staging; //!< Single precision copy of the last batch of vertexes.
+public:
+    //! Empty.
+    GLBufferSink() {}
+
+    ~GLBufferSink();
+
+    void Vertexes(const Vector *, const Vector *, int) override;
+
+    void Triangles(const int *, int) override;
+
+    Box GetBox() const;
+
+    friend class MeshWidget;
+protected:
+    static void Reserve(GLuint &, size_t &, size_t, size_t);
+};
+
 class MeshWidget : public QOpenGLWidget {
     // Must include this if you use Qt signals/slots
 Q_OBJECT
@@ -93,6 +124,7 @@ protected:
         GLuint fullBuffer;            //!< Mesh buffer. Contains 3D normals, 2D vertices and heights.
         GLuint indexBuffer;            //!< Mesh index buffer.
         int triangleCount;            //!< Triangle count to draw.
+        size_t aoOffset;            //!< Offset of the AO colors in the mesh buffer, 0 if the mesh has no colors.
         float TRSMatrix[16];        //!< Translation-Rotation-Scale Matrix.
         Box bbox;                    //!< Bounding box of the mesh.
 
@@ -107,8 +139,14 @@ protected:
 
         MeshGL(const MeshColor &mesh, const Vector &position = Vector::Null);
 
+        MeshGL(GLBufferSink &sink, const Vector &position = Vector::Null);
+
+        MeshGL(const MeshFloat &mesh, const Vector &position = Vector::Null);
+
         void Delete();
 
+        void UpdateAO(const MeshColor &mesh);
+
         void SetFrame(const Vector &position);
     };
 
@@ -136,6 +174,9 @@ protected:
     // Profiling
     RenderingProfiler profiler;
 
+    // Preview rendered on the CPU, drawn over the scene if not null
+    QImage preview;
+
 public:
     MeshWidget();
 
@@ -145,12 +186,18 @@ public:
 
     void AddMesh(const QString &, const MeshColor &, const Vector & = Vector::Null);
 
+    void AddMesh(const QString &, GLBufferSink &, const Vector & = Vector::Null);
+
+    void AddMesh(const QString &, const MeshFloat &, const Vector & = Vector::Null);
+
     void DeleteMesh(const QString &);
 
     void ClearAll();
 
     void UpdateMesh(const QString &, const Vector &);
 
+    void UpdateAO(const QString &, const MeshColor &);
+
     void EnableMesh(const QString &);
 
     void DisableMesh(const QString &);
@@ -179,6 +226,10 @@ public:
 
     void SetShadingGlobal(MeshShading);
 
+    void SetPreview(const SphereTracer &);
+
+    void ClearPreview();
+
 private:
     void _InternalGetMouseGlobalPosition(QMouseEvent *e, int &x0, int &y0) const;
 
@@ -191,6 +242,8 @@ protected:
 
     virtual void RenderStats();
 
+    virtual void RenderPreview();
+
 signals:
 
     void _signalUpdate();
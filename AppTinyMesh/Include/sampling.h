@@ -0,0 +1,70 @@
+// Hemisphere sampling
+
+#pragma once
+
+#include <vector>
+
+#include "mathematics.h"
+
+//! Distribution of the directions of a hemisphere sampling set.
+enum class HemisphereSampling {
+    Uniform = 0,        //!< Random directions, uniform with respect to the solid angle.
+    Cosine = 1,         //!< Random directions, cosine-weighted.
+    Stratified = 2,     //!< Cosine-weighted directions, stratified along both parameters.
+    LowDiscrepancy = 3, //!< Cosine-weighted directions from the Halton sequence.
+};
+
+class HemisphereSampler {
+protected:
+    std::vector<Vector> directions; //!< Unit directions around the z axis.
+public:
+    explicit HemisphereSampler(int, HemisphereSampling = HemisphereSampling::Stratified, int = 0);
+
+    //! Empty.
+    ~HemisphereSampler() {}
+
+    int Size() const;
+
+    Vector operator[](int) const;
+
+    Vector Direction(int, const Vector &, const Vector &, const Vector &) const;
+
+    static double Halton(int, int);
+
+protected:
+    static Vector Cosine(double, double);
+
+    static Vector Uniform(double, double);
+};
+
+/*!
+\brief Return the number of directions of the set.
+*/
+inline int HemisphereSampler::Size() const {
+    return int(directions.size());
+}
+
+/*!
+\brief Return the i-th direction, around the z axis.
+\param i Index.
+*/
+inline Vector HemisphereSampler::operator[](int i) const {
+    return directions[i];
+}
+
+/*!
+\brief Return the i-th direction, mapped to the hemisphere around a normal.
+
+The frame should be orthonormal, for instance computed with Vector::Orthonormal():
+\code
+Vector x, y;
+n.Orthonormal(x, y);
+Vector d = sampler.Direction(i, x, y, n);
+\endcode
+\param i Index.
+\param x, y, n Frame, with n the normal.
+*/
+inline Vector HemisphereSampler::Direction(int i, const Vector &x, const Vector &y, const Vector &n) const {
+    const Vector &d = directions[i];
+    return x * d[0] + y * d[1] + n * d[2];
+}
@@ -0,0 +1,78 @@
+// Scene of analytic primitives
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "box.h"
+
+class Scene : public Intersectable {
+public:
+    //! Primitive placed in the scene with a transformation.
+    struct Instance {
+        std::shared_ptr<const Primitive> primitive; //!< Primitive, defined in its own frame and possibly shared.
+        Matrix forward;     //!< Rotation and scale, from the frame of the primitive to the scene.
+        Matrix inverse;     //!< Inverse of the rotation and scale.
+        Vector translation; //!< Translation, applied after the rotation and scale.
+        Box box;            //!< Bounding box in the scene.
+    };
+
+    //! Node of the flattened top-level hierarchy.
+    struct Node {
+        Vector a, b; //!< Lower and upper vertex of the bounding box.
+        int offset;  //!< Index of the first entry of Scene::indexes for a leaf, index of the second child for an inner node.
+        int count;   //!< Number of instances for a leaf, 0 for an inner node.
+    };
+
+protected:
+    std::vector<Instance> instances; //!< Instances.
+    std::vector<int> indexes;        //!< Instance indexes, sorted by leaf.
+    std::vector<Node> nodes;         //!< Nodes, the first child of an inner node is stored right after it.
+public:
+    //! Empty.
+    Scene() {}
+
+    //! Empty.
+    ~Scene() {}
+
+    int Add(const std::shared_ptr<const Primitive> &, const Vector & = Vector::Null,
+            const Matrix & = Matrix::Idendity, const Vector & = Vector(1.0));
+
+    void Build();
+
+    int Instances() const;
+
+    const Instance &GetInstance(int) const;
+
+    Box GetBox() const;
+
+    bool Intersect(const Ray &, double &, double &, double &) const override;
+
+    bool Intersect(const Ray &, double &, double &, double &, int &) const;
+
+    bool Occluded(const Ray &, double, double) const override;
+
+protected:
+    int Build(int, int);
+
+    static Ray Local(const Instance &, const Ray &, double &);
+
+protected:
+    static const int leaf; //!< Maximum number of instances in a leaf.
+};
+
+/*!
+\brief Return the number of instances.
+*/
+inline int Scene::Instances() const {
+    return int(instances.size());
+}
+
+/*!
+\brief Return an instance.
+\param i Index, as returned by Add().
+*/
+inline const Scene::Instance &Scene::GetInstance(int i) const {
+    return instances[i];
+}
@@ -42,8 +42,16 @@ public:
 
     void Scale(double x) override;
 
+    Box GetBox() const override;
+
+    double SignedDistance(const Vector &p) const override;
+
+    double SignedDistanceGradient(const Vector &p, Vector &g) const override;
+
     bool Intersect(const Ray &ray, double &d, double &d1, double &d2) const override;
 
+    bool Occluded(const Ray &ray, double tmin, double tmax) const override;
+
 
 private:
     double r2;
@@ -0,0 +1,42 @@
+// Sphere tracing
+
+#pragma once
+
+#include "camera.h"
+#include "color.h"
+#include "implicits.h"
+
+class SphereTracer {
+protected:
+    const AnalyticScalarField &field; //!< Scalar field.
+    Box box;                          //!< Region of the surface, rays are clipped against it.
+    double lipschitz;                 //!< Lipschitz constant of the field.
+    int steps = 256;                  //!< Maximum number of steps along a ray.
+    double epsilon = 1.0e-4;          //!< Distance under which a point is on the surface.
+    Vector light = Normalized(Vector(1.0, 1.0, 2.0)); //!< Direction toward the light.
+public:
+    SphereTracer(const AnalyticScalarField &, const Box &);
+
+    //! Empty.
+    ~SphereTracer() {}
+
+    void SetSteps(int, double = 1.0e-4);
+
+    bool Trace(const Ray &, double &) const;
+
+    Color Shade(const Ray &) const;
+
+    void Render(const Camera &, int, int, unsigned int *, int = 16) const;
+
+    static unsigned int Pack(const Color &);
+};
+
+/*!
+\brief Set the parameters of the marching along rays.
+\param n Maximum number of steps.
+\param e Distance under which a point is on the surface.
+*/
+inline void SphereTracer::SetSteps(int n, double e) {
+    steps = n;
+    epsilon = e;
+}
@@ -16,6 +16,12 @@ public:
 
     bool Intersect(const Ray &ray, double &d, double &d1, double &d2) const override;
 
+    bool Occluded(const Ray &ray, double tmin, double tmax) const override;
+
+    double SignedDistance(const Vector &p) const override;
+
+    double SignedDistanceGradient(const Vector &p, Vector &g) const override;
+
     const Vector &getC() const;
 
     double getA() const;
@@ -31,4 +37,13 @@ public:
     void Translate(const Vector &v) override;
 
     void Scale(double x) override;
+
+    Box GetBox() const override;
+
+protected:
+    double March(const Ray &ray, double t, double tmax, double sign) const;
+
+    static const double epsilon; //!< Distance to the surface under which sphere tracing stops.
+    static const double grazing; //!< Distance relative to the marched depth under which a ray that runs out of steps hits.
+    static const int steps;      //!< Maximum number of sphere tracing steps.
 };
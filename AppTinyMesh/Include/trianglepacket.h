@@ -0,0 +1,54 @@
+// Triangle packet
+
+#pragma once
+
+#include "mesh.h"
+
+class TrianglePacket {
+public:
+    static constexpr int Size = 4; //!< Number of triangles in a packet.
+protected:
+    alignas(32) double v0[3][Size]; //!< First vertex of the triangles, stored by coordinate.
+    alignas(32) double e1[3][Size]; //!< First edge of the triangles.
+    alignas(32) double e2[3][Size]; //!< Second edge of the triangles.
+    int count = 0;                  //!< Number of triangles actually stored.
+public:
+    TrianglePacket();
+
+    explicit TrianglePacket(const Triangle *, int);
+
+    //! Empty.
+    ~TrianglePacket() {}
+
+    void Set(int, const Triangle &);
+
+    void Set(int, const FlatTriangle &);
+
+    int Count() const;
+
+    int Intersect(const Ray &, double, double, double *, double *, double *) const;
+
+    bool Intersect(const Ray &, double, double &, double &, double &, int &) const;
+
+    bool Occluded(const Ray &, double, double) const;
+
+protected:
+    static const double epsilon; //!< Internal epsilon constant, same as the triangle one.
+};
+
+/*!
+\brief Return the number of triangles stored in the packet.
+*/
+inline int TrianglePacket::Count() const {
+    return count;
+}
+
+/*!
+\brief Check whether a ray hits any triangle of the packet inside a given interval.
+\param ray The ray (direction should be of unit length).
+\param tmin, tmax Interval.
+*/
+inline bool TrianglePacket::Occluded(const Ray &ray, double tmin, double tmax) const {
+    double t[Size], u[Size], v[Size];
+    return Intersect(ray, tmin, tmax, t, u, v) != 0;
+}
@@ -0,0 +1,66 @@
+// Triangle sinks
+
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+
+/*!
+\brief Receiver of a triangle mesh produced by batches.
+
+Vertexes are indexed globally in the order they are received, and triangles only refer to vertexes
+received in the same or previous batches, so that a batch can be written out as soon as it is received.
+*/
+class TriangleSink {
+public:
+    //! Empty.
+    virtual ~TriangleSink() {}
+
+    virtual void Vertexes(const Vector *, const Vector *, int) = 0;
+
+    virtual void Triangles(const int *, int) = 0;
+
+    //! Called once after the last batch.
+    virtual void Finish() {}
+};
+
+class MeshSink : public TriangleSink {
+protected:
+    Mesh &mesh;                 //!< Returned mesh.
+    std::vector<Vector> vertex; //!< Vertexes.
+    std::vector<Vector> normal; //!< Normals.
+    std::vector<int> triangle;  //!< Triangles.
+public:
+    explicit MeshSink(Mesh &);
+
+    void Vertexes(const Vector *, const Vector *, int) override;
+
+    void Triangles(const int *, int) override;
+
+    void Finish() override;
+};
+
+class ObjSink : public TriangleSink {
+protected:
+    std::ofstream out; //!< Output file.
+public:
+    explicit ObjSink(const std::string &, const std::string & = "mesh");
+
+    void Vertexes(const Vector *, const Vector *, int) override;
+
+    void Triangles(const int *, int) override;
+
+    void Finish() override;
+
+    bool IsOpen() const;
+};
+
+/*!
+\brief Check if the file could be opened.
+*/
+inline bool ObjSink::IsOpen() const {
+    return out.is_open();
+}
@@ -0,0 +1,55 @@
+// Array views
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/*!
+\class View view.h
+\brief Read-only view of a contiguous array, which does not own its elements.
+
+This is a minimal equivalent of C++20 std::span<const T>, so that accessors may expose internal arrays
+without copying them. A view is invalidated by any modification of the size of the array it refers to.
+
+\code
+View<int> indexes = mesh.VertexIndexView();
+for (int i : indexes) { ... }
+\endcode
+*/
+template<typename T>
+class View {
+protected:
+    const T *first = nullptr; //!< First element.
+    size_t count = 0;         //!< Number of elements.
+public:
+    //! Empty.
+    View() {}
+
+    //! Create a view of an array.
+    View(const T *first, size_t count) : first(first), count(count) {}
+
+    //! Create a view of a vector.
+    View(const std::vector<T> &v) : first(v.data()), count(v.size()) {}
+
+    //! Views of temporary vectors would dangle at the end of the statement.
+    View(std::vector<T> &&) = delete;
+
+    //! Return a pointer to the first element.
+    const T *data() const { return first; }
+
+    //! Return the number of elements.
+    size_t size() const { return count; }
+
+    //! Check whether the view is empty.
+    bool empty() const { return count == 0; }
+
+    //! Return an element.
+    const T &operator[](size_t i) const { return first[i]; }
+
+    //! Return an iterator to the first element.
+    const T *begin() const { return first; }
+
+    //! Return an iterator past the last element.
+    const T *end() const { return first + count; }
+};
@@ -0,0 +1,93 @@
+// Mesh adjacency
+
+#include "adjacency.h"
+
+/*!
+\class Adjacency adjacency.h
+\brief Adjacency of a triangle mesh in compressed sparse row format.
+
+Incident triangles and neighbors of every vertex are stored contiguously, and every half-edge knows its
+opposite half-edge, so that neighborhood queries do not scan the whole mesh. The structure is built in
+linear time with a counting sort of the corners of the triangles, see Mesh::GetAdjacency().
+*/
+
+/*!
+\brief Build the adjacency of a set of triangles.
+\param n Number of vertexes.
+\param varray Vertex indexes, three per triangle.
+*/
+Adjacency::Adjacency(int n, const std::vector<int> &varray) : triangles(int(varray.size()) / 3) {
+    const int corners = 3 * triangles;
+
+    // Counting sort of the corners by vertex, triangles are sorted by index for every vertex
+    faceOffset.assign(n + 1, 0);
+    for (int c = 0; c < corners; c++) {
+        faceOffset[varray[c] + 1]++;
+    }
+    for (int v = 0; v < n; v++) {
+        faceOffset[v + 1] += faceOffset[v];
+    }
+    faces.resize(corners);
+    std::vector<int> next(faceOffset.begin(), faceOffset.end() - 1);
+    for (int c = 0; c < corners; c++) {
+        faces[next[varray[c]]++] = c / 3;
+    }
+
+    // Neighbors, counted then stored, duplicates are removed with stamps
+    std::vector<int> stamp(n, -1);
+    neighborOffset.assign(n + 1, 0);
+    for (int v = 0; v < n; v++) {
+        int count = 0;
+        for (int k = faceOffset[v]; k < faceOffset[v + 1]; k++) {
+            for (int i = 0; i < 3; i++) {
+                const int w = varray[3 * faces[k] + i];
+                if (w != v && stamp[w] != v) {
+                    stamp[w] = v;
+                    count++;
+                }
+            }
+        }
+        neighborOffset[v + 1] = neighborOffset[v] + count;
+    }
+    neighbors.resize(neighborOffset[n]);
+    for (int v = 0; v < n; v++) {
+        int e = neighborOffset[v];
+        for (int k = faceOffset[v]; k < faceOffset[v + 1]; k++) {
+            for (int i = 0; i < 3; i++) {
+                const int w = varray[3 * faces[k] + i];
+                if (w != v && stamp[w] != n + v) {
+                    stamp[w] = n + v;
+                    neighbors[e++] = w;
+                }
+            }
+        }
+    }
+
+    // Twins, searched among the triangles incident to the end vertex of every half-edge
+    twins.assign(corners, -1);
+    for (int h = 0; h < corners; h++) {
+        const int a = varray[h];
+        const int b = varray[h - h % 3 + (h + 1) % 3];
+        int twin = -1;
+        int count = 0;
+        for (int k = faceOffset[b]; k < faceOffset[b + 1]; k++) {
+            const int t = 3 * faces[k];
+            for (int i = 0; i < 3; i++) {
+                if (varray[t + i] == b && varray[t + (i + 1) % 3] == a) {
+                    twin = t + i;
+                    count++;
+                }
+            }
+        }
+        if (count == 1) {
+            twins[h] = twin;
+        }
+    }
+
+    // Edges shared by more than two triangles are not paired
+    for (int h = 0; h < corners; h++) {
+        if (twins[h] != -1 && twins[twins[h]] != h) {
+            twins[h] = -1;
+        }
+    }
+}
@@ -0,0 +1,173 @@
+// Progressive ambient occlusion
+
+#include "aobaker.h"
+#include "bvh.h"
+
+#include <algorithm>
+
+const double AOBaker::bias = 1.0e-1;
+
+/*!
+\class AOBaker aobaker.h
+\brief Compute the ambient occlusion of a mesh progressively on a worker thread.
+
+The occlusion is refined in passes with an increasing number of rays per vertex.
+Rays of a pass are added to the ones of the previous passes, and the estimate is
+published at the end of every pass so that the interface can display it while the
+computation goes on.
+
+\code
+AOBaker baker;
+baker.Start(mesh, AOBaker::Passes(128), 4.0);
+// Later, from a timer for instance
+std::vector<Color> ao;
+int rays;
+if (baker.Poll(ao, rays))
+{
+  meshColor.SetAO(ao);
+}
+\endcode
+
+Starting a new computation or destroying the baker cancels the current one.
+*/
+
+/*!
+\brief Cancel the computation and wait for the worker.
+*/
+AOBaker::~AOBaker() {
+    Cancel();
+}
+
+/*!
+\brief Start computing the ambient occlusion of a mesh, cancelling any running computation.
+
+The mesh is copied, so it may be modified or destroyed while the worker is running.
+
+\param mesh The mesh.
+\param passes Increasing total numbers of rays per vertex at the end of every pass, see Passes().
+\param range Length of the rays.
+\param sampling Distribution of the ray directions. Low discrepancy directions are consecutive
+samples of the same sequence over all passes, random ones are drawn independently for every pass.
+*/
+void AOBaker::Start(const Mesh &mesh, const std::vector<int> &passes, double range, HemisphereSampling sampling) {
+    Cancel();
+    running = true;
+    thread = std::thread(&AOBaker::Run, this, mesh, passes, range, sampling);
+}
+
+/*!
+\brief Cancel the running computation, if any, and wait for the worker.
+
+The worker stops after the vertices it is currently processing. Buffers that were not polled are discarded.
+*/
+void AOBaker::Cancel() {
+    cancel = true;
+    if (thread.joinable()) {
+        thread.join();
+    }
+    cancel = false;
+    running = false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    fresh = false;
+}
+
+/*!
+\brief Get the last published ambient occlusion, if it was not polled yet.
+
+This function does not block while the worker is computing a pass.
+\param ao Ambient occlusion, one color per vertex.
+\param n Number of rays per vertex used to compute it.
+\return Whether a new buffer was returned.
+*/
+bool AOBaker::Poll(std::vector<Color> &ao, int &n) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!fresh) {
+        return false;
+    }
+    ao = published;
+    n = rays;
+    fresh = false;
+    return true;
+}
+
+/*!
+\brief Compute the total numbers of rays per vertex of a progressive computation.
+
+Passes start with 8 rays and are multiplied by 4 until the final number is reached, for instance 8, 32, 128.
+\param n Final number of rays per vertex.
+*/
+std::vector<int> AOBaker::Passes(int n) {
+    std::vector<int> passes;
+    for (int k = 8; k < n; k *= 4) {
+        passes.push_back(k);
+    }
+    passes.push_back(std::max(n, 1));
+    return passes;
+}
+
+/*!
+\brief Count the number of rays occluded from a vertex.
+\param occluder Geometry casting the occlusion, usually the hierarchy of the mesh.
+\param vertex, normal The vertex and its normal, which should be of unit length.
+\param sampler Ray directions around the normal.
+\param range Length of the rays.
+*/
+int AOBaker::Occlusion(const Intersectable &occluder, const Vector &vertex, const Vector &normal,
+                       const HemisphereSampler &sampler, double range) {
+    const Vector origin = vertex + normal * bias;
+    Vector x, y;
+    normal.Orthonormal(x, y);
+
+    int count = 0;
+    for (int i = 0; i < sampler.Size(); i++) {
+        if (occluder.Occluded(Ray(origin, sampler.Direction(i, x, y, normal)), 0.0, range)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/*!
+\brief Compute all passes, executed by the worker thread.
+
+Every pass is computed in parallel over the vertices when OpenMP is enabled.
+\param mesh The mesh.
+\param passes Total numbers of rays at the end of every pass.
+\param range Length of the rays.
+\param sampling Distribution of the ray directions.
+*/
+void AOBaker::Run(const Mesh &mesh, const std::vector<int> &passes, double range, HemisphereSampling sampling) {
+    const int n = mesh.Vertexes();
+    const BVH bvh(mesh);
+
+    std::vector<int> occluded(n, 0);
+    std::vector<Color> ao(n);
+    int done = 0;
+    for (int pass: passes) {
+        if (pass <= done) {
+            continue;
+        }
+        const HemisphereSampler sampler(pass - done, sampling, done);
+
+#pragma omp parallel for schedule(dynamic, 64)
+        for (int i = 0; i < n; i++) {
+            if (cancel) {
+                continue;
+            }
+            occluded[i] += Occlusion(bvh, mesh.Vertex(i), Normalized(mesh.Normal(i)), sampler, range);
+            double res = Math::Clamp(1.0 - double(occluded[i]) / double(pass));
+            ao[i] = Color(res, res, res);
+        }
+        if (cancel) {
+            break;
+        }
+        done = pass;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        published = ao;
+        rays = done;
+        fresh = true;
+    }
+    running = false;
+}
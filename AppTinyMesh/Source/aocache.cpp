@@ -0,0 +1,171 @@
+// Ambient occlusion cache
+
+#include "aocache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+const char AOCache::magic[4] = {'T', 'M', 'A', 'O'};
+const int AOCache::version = 2;
+
+/*!
+\class AOCache aocache.h
+\brief Persistent cache of the ambient occlusion of meshes.
+
+Every entry is a binary file named after a key, which combines a hash of the geometry
+of the mesh with the parameters of the ambient occlusion, see Key().
+
+The file stores a small header (signature, version, key and number of vertices)
+followed by a single double per vertex, as the ambient occlusion is a gray level, so that
+a cache hit returns exactly the values of a fresh computation.
+
+\code
+AOCache cache;
+std::uint64_t key = AOCache::Key(mesh, rays, range, sampling);
+std::vector<Color> ao;
+if (!cache.Load(key, mesh.Vertexes(), ao))
+{
+  // Compute ao, then
+  cache.Save(key, ao);
+}
+\endcode
+
+Invalid or truncated files are ignored, so it is always safe to delete the cache directory.
+*/
+
+/*!
+\brief Create a cache.
+
+A relative directory is resolved against the working directory of the process, applications should pass
+an absolute location such as the cache directory of the user.
+
+\param directory Directory of the cache files, created when the first entry is saved.
+*/
+AOCache::AOCache(const std::string &directory) : directory(directory) {
+}
+
+/*!
+\brief Compute the key of the ambient occlusion of a mesh.
+\param mesh The mesh.
+\param rays Number of rays per vertex.
+\param range Length of the rays.
+\param sampling Distribution of the ray directions.
+*/
+std::uint64_t AOCache::Key(const Mesh &mesh, int rays, double range, HemisphereSampling sampling) {
+    // Mix the parameters into the hash of the mesh with the same FNV-1a step
+    std::uint64_t hash = mesh.Hash();
+    const std::int64_t parameters[2] = {rays, std::int64_t(sampling)};
+    unsigned char bytes[sizeof(parameters) + sizeof(double)];
+    std::memcpy(bytes, parameters, sizeof(parameters));
+    std::memcpy(bytes + sizeof(parameters), &range, sizeof(double));
+    for (unsigned char byte: bytes) {
+        hash = (hash ^ byte) * 1099511628211ull;
+    }
+    return hash;
+}
+
+/*!
+\brief Return the path of the file of a given key.
+\param key Key.
+*/
+std::string AOCache::File(std::uint64_t key) const {
+    static const char digits[] = "0123456789abcdef";
+    std::string name(16, '0');
+    for (int i = 15; i >= 0; i--) {
+        name[i] = digits[key & 0xf];
+        key >>= 4;
+    }
+    return (std::filesystem::path(directory) / (name + ".ao")).string();
+}
+
+/*!
+\brief Load the ambient occlusion of a given key.
+\param key Key.
+\param n Expected number of vertices.
+\param ao Ambient occlusion, one color per vertex, only modified if the entry was found.
+\return Whether a valid entry was found.
+*/
+bool AOCache::Load(std::uint64_t key, int n, std::vector<Color> &ao) const {
+    std::ifstream in(File(key), std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    char signature[4];
+    int fileVersion = 0;
+    std::uint64_t fileKey = 0;
+    int count = 0;
+    in.read(signature, sizeof(signature));
+    in.read(reinterpret_cast<char *>(&fileVersion), sizeof(fileVersion));
+    in.read(reinterpret_cast<char *>(&fileKey), sizeof(fileKey));
+    in.read(reinterpret_cast<char *>(&count), sizeof(count));
+    if (!in || std::memcmp(signature, magic, sizeof(magic)) != 0 || fileVersion != version || fileKey != key ||
+        count != n) {
+        return false;
+    }
+
+    std::vector<double> occlusion(n);
+    in.read(reinterpret_cast<char *>(occlusion.data()), std::streamsize(n * sizeof(double)));
+    if (!in) {
+        return false;
+    }
+
+    ao.resize(n);
+    for (int i = 0; i < n; i++) {
+        ao[i] = Color(occlusion[i], occlusion[i], occlusion[i]);
+    }
+    return true;
+}
+
+/*!
+\brief Save the ambient occlusion of a given key.
+
+The file is written under a temporary name and then renamed, so that an interrupted
+write never leaves a partial entry.
+
+\param key Key.
+\param ao Ambient occlusion, one color per vertex.
+\return Whether the entry was written.
+*/
+bool AOCache::Save(std::uint64_t key, const std::vector<Color> &ao) const {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        return false;
+    }
+
+    const int n = int(ao.size());
+    std::vector<double> occlusion(n);
+    for (int i = 0; i < n; i++) {
+        occlusion[i] = ao[i][0];
+    }
+
+    const std::string file = File(key);
+    const std::string temporary = file + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(magic, sizeof(magic));
+        out.write(reinterpret_cast<const char *>(&version), sizeof(version));
+        out.write(reinterpret_cast<const char *>(&key), sizeof(key));
+        out.write(reinterpret_cast<const char *>(&n), sizeof(n));
+        out.write(reinterpret_cast<const char *>(occlusion.data()), std::streamsize(n * sizeof(double)));
+        if (!out) {
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, file, error);
+    return !error;
+}
+
+/*!
+\brief Remove all entries of the cache.
+*/
+void AOCache::Clear() const {
+    std::error_code error;
+    for (const auto &entry: std::filesystem::directory_iterator(directory, error)) {
+        if (entry.path().extension() == ".ao") {
+            std::filesystem::remove(entry.path(), error);
+        }
+    }
+}
@@ -121,6 +121,42 @@ Box::Box(const Box& x, const Box& y)
   b = Vector::Max(x.b, y.b);
 }
 
+/*!
+\brief Compute the signed distance to the box.
+\param p Point.
+\return The euclidean distance outside, minus the distance to the closest face inside.
+*/
+double Box::SignedDistance(const Vector& p) const
+{
+  const Vector q = Abs(p - Center()) - 0.5 * (b - a);
+  return Norm(Vector::Max(q, Vector::Null)) + Math::Min(Math::Max(q[0], q[1], q[2]), 0.0);
+}
+
+/*!
+\brief Compute the signed distance to the box and its gradient.
+
+Outside, the gradient points from the closest point of the box. Inside, it is the normal of the closest face.
+
+\param p Point.
+\param g Returned gradient.
+*/
+double Box::SignedDistanceGradient(const Vector& p, Vector& g) const
+{
+  const Vector o = p - Center();
+  const Vector q = Abs(o) - 0.5 * (b - a);
+  const Vector w = Vector::Max(q, Vector::Null);
+  const double d = Norm(w);
+  if (d > 0.0)
+  {
+    g = Vector(o[0] < 0.0 ? -w[0] : w[0], o[1] < 0.0 ? -w[1] : w[1], o[2] < 0.0 ? -w[2] : w[2]) / d;
+    return d;
+  }
+  const int k = (q[0] >= q[1] && q[0] >= q[2]) ? 0 : (q[1] >= q[2] ? 1 : 2);
+  g = Vector::Null;
+  g[k] = o[k] < 0.0 ? -1.0 : 1.0;
+  return q[k];
+}
+
 /*!
 \brief Computes the sub-box in the n-th octant.
 \param n Octant index.
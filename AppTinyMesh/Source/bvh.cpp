@@ -0,0 +1,313 @@
+// Bounding volume hierarchy
+
+#include "bvh.h"
+
+#include <algorithm>
+#include <limits>
+
+const int BVH::bins = 16;
+const int BVH::depth = 32;
+
+/*!
+\class BVH bvh.h
+\brief Bounding volume hierarchy over the triangles of a mesh.
+
+The hierarchy is built top-down with a binned surface area heuristic, and
+flattened into an array of nodes: the first child of an inner node is the next node
+in the array, the second child is referenced by Node::offset.
+
+Leaves contain at most TrianglePacket::Size triangles, stored in a single packet.
+
+\code
+BVH bvh(mesh);
+double t, u, v;
+int i;
+if (bvh.Intersect(ray, t, u, v, i))
+{
+  Triangle triangle = mesh.GetTriangle(i);
+}
+\endcode
+*/
+
+/*!
+\brief Build the hierarchy of a mesh.
+\param mesh The mesh.
+*/
+BVH::BVH(const Mesh &mesh) {
+    const std::vector<FlatTriangle> &triangles = mesh.FlatTriangles();
+    const int n = int(triangles.size());
+    if (n == 0) {
+        return;
+    }
+
+    std::vector<Box> boxes;
+    std::vector<Vector> centers;
+    std::vector<int> ids(n);
+    boxes.reserve(n);
+    centers.reserve(n);
+    for (int i = 0; i < n; i++) {
+        const Vector a = mesh.Vertex(i, 0);
+        const Vector b = mesh.Vertex(i, 1);
+        const Vector c = mesh.Vertex(i, 2);
+        boxes.emplace_back(Vector::Min(Vector::Min(a, b), c), Vector::Max(Vector::Max(a, b), c));
+        centers.push_back(boxes.back().Center());
+        ids[i] = i;
+    }
+
+    nodes.reserve(2 * n);
+    Build(ids, boxes, centers, 0, n, 0);
+
+    // Gather the triangles of every leaf into a packet
+    for (Node &node: nodes) {
+        if (node.count == 0) {
+            continue;
+        }
+        const int first = node.offset;
+        node.offset = int(packets.size());
+        packets.emplace_back();
+        for (int i = 0; i < node.count; i++) {
+            packets.back().Set(i, triangles[ids[first + i]]);
+            indexes.push_back(ids[first + i]);
+        }
+        indexes.resize(packets.size() * TrianglePacket::Size, -1);
+    }
+}
+
+/*!
+\brief Recursively build the node enclosing a range of triangles.
+
+\param ids Triangle indexes, sorted in place.
+\param boxes, centers Bounding boxes and their centers, for every triangle.
+\param first, last Range of triangles.
+\param level Depth of the node.
+\return The index of the node.
+*/
+int BVH::Build(std::vector<int> &ids, const std::vector<Box> &boxes, const std::vector<Vector> &centers, int first,
+               int last, int level) {
+    const int index = int(nodes.size());
+    nodes.push_back(Node());
+
+    Box box = boxes[ids[first]];
+    Vector cmin = centers[ids[first]];
+    Vector cmax = cmin;
+    for (int i = first + 1; i < last; i++) {
+        box = Box(box, boxes[ids[i]]);
+        cmin = Vector::Min(cmin, centers[ids[i]]);
+        cmax = Vector::Max(cmax, centers[ids[i]]);
+    }
+    nodes[index].a = box[0];
+    nodes[index].b = box[1];
+
+    const int count = last - first;
+    if (count <= TrianglePacket::Size) {
+        nodes[index].offset = first;
+        nodes[index].count = count;
+        return index;
+    }
+
+    // Evaluate the surface area heuristic at the bin boundaries along every axis
+    int bestAxis = -1;
+    int bestSplit = 0;
+    double bestCost = count * box.Area();
+    for (int axis = 0; axis < 3; axis++) {
+        const double extent = cmax[axis] - cmin[axis];
+        if (extent <= 0.0) {
+            continue;
+        }
+        const double scale = bins / extent;
+
+        int binCount[bins] = {};
+        Box binBox[bins];
+        for (int i = first; i < last; i++) {
+            int k = std::min(bins - 1, int((centers[ids[i]][axis] - cmin[axis]) * scale));
+            binBox[k] = binCount[k] == 0 ? boxes[ids[i]] : Box(binBox[k], boxes[ids[i]]);
+            binCount[k]++;
+        }
+
+        // Sweep from the right to accumulate the cost of the upper part
+        double rightArea[bins];
+        int rightCount[bins];
+        Box right;
+        int nr = 0;
+        for (int k = bins - 1; k > 0; k--) {
+            if (binCount[k] != 0) {
+                right = nr == 0 ? binBox[k] : Box(right, binBox[k]);
+                nr += binCount[k];
+            }
+            rightArea[k] = nr == 0 ? 0.0 : right.Area();
+            rightCount[k] = nr;
+        }
+
+        Box left;
+        int nl = 0;
+        for (int k = 0; k < bins - 1; k++) {
+            if (binCount[k] != 0) {
+                left = nl == 0 ? binBox[k] : Box(left, binBox[k]);
+                nl += binCount[k];
+            }
+            if (nl == 0 || rightCount[k + 1] == 0) {
+                continue;
+            }
+            double cost = nl * left.Area() + rightCount[k + 1] * rightArea[k + 1];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = k;
+            }
+        }
+    }
+
+    int middle;
+    if (bestAxis != -1 && level < depth) {
+        const double scale = bins / (cmax[bestAxis] - cmin[bestAxis]);
+        middle = int(std::partition(ids.begin() + first, ids.begin() + last, [&](int i) {
+            return std::min(bins - 1, int((centers[i][bestAxis] - cmin[bestAxis]) * scale)) <= bestSplit;
+        }) - ids.begin());
+    } else {
+        // The heuristic did not find any split cheaper than a leaf, all centers are coincident,
+        // or the tree is getting too deep: split at the median along the largest axis
+        Vector d = cmax - cmin;
+        bestAxis = (d[0] > d[1] && d[0] > d[2]) ? 0 : (d[1] > d[2] ? 1 : 2);
+        middle = (first + last) / 2;
+        std::nth_element(ids.begin() + first, ids.begin() + middle, ids.begin() + last, [&](int i, int j) {
+            return centers[i][bestAxis] < centers[j][bestAxis];
+        });
+    }
+
+    Build(ids, boxes, centers, first, middle, level + 1);
+    int second = Build(ids, boxes, centers, middle, last, level + 1);
+
+    nodes[index].offset = second;
+    nodes[index].count = 0;
+    nodes[index].axis = bestAxis;
+    return index;
+}
+
+/*!
+\brief Compute the intersection between a ray and the box of a node.
+
+\param node The node.
+\param o Origin of the ray.
+\param inv Inverse of the direction of the ray.
+\param tmin, tmax Interval of depths.
+*/
+inline bool BVH::Slab(const Node &node, const Vector &o, const Vector &inv, double tmin, double tmax) {
+    double t0 = tmin;
+    double t1 = tmax;
+    for (int i = 0; i < 3; i++) {
+        double ta = (node.a[i] - o[i]) * inv[i];
+        double tb = (node.b[i] - o[i]) * inv[i];
+        if (ta > tb) std::swap(ta, tb);
+        t0 = ta > t0 ? ta : t0;
+        t1 = tb < t1 ? tb : t1;
+        if (t0 > t1) return false;
+    }
+    return true;
+}
+
+/*!
+\brief Compute the closest intersection between a ray and the triangles of the hierarchy.
+
+Only intersections with a strictly positive depth are reported.
+
+\param ray The ray (direction should be of unit length).
+\param t Intersection depth.
+\param u,v Parametric coordinates of the intersection in the triangle.
+\param index Index of the intersected triangle in the original mesh.
+*/
+bool BVH::Intersect(const Ray &ray, double &t, double &u, double &v, int &index) const {
+    if (nodes.empty()) {
+        return false;
+    }
+
+    const Vector o = ray.Origin();
+    const Vector inv = ray.Direction().Inverse();
+    const bool negative[3] = {inv[0] < 0.0, inv[1] < 0.0, inv[2] < 0.0};
+
+    double tmax = std::numeric_limits<double>::max();
+    int hit = -1;
+
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node &node = nodes[stack[--top]];
+        if (!Slab(node, o, inv, 0.0, tmax)) {
+            continue;
+        }
+
+        if (node.count > 0) {
+            int lane;
+            if (packets[node.offset].Intersect(ray, 0.0, tmax, u, v, lane)) {
+                hit = node.offset * TrianglePacket::Size + lane;
+            }
+        } else {
+            // Push the far child first so that the near child is processed first
+            int first = int(&node - nodes.data()) + 1;
+            if (negative[node.axis]) {
+                stack[top++] = first;
+                stack[top++] = node.offset;
+            } else {
+                stack[top++] = node.offset;
+                stack[top++] = first;
+            }
+        }
+    }
+
+    if (hit == -1) {
+        return false;
+    }
+    t = tmax;
+    index = indexes[hit];
+    return true;
+}
+
+/*!
+\brief Overloaded.
+
+\param ray The ray (direction should be of unit length).
+\param t Intersection depth.
+\param u,v Parametric coordinates of the intersection in the triangle.
+*/
+bool BVH::Intersect(const Ray &ray, double &t, double &u, double &v) const {
+    int index;
+    return Intersect(ray, t, u, v, index);
+}
+
+/*!
+\brief Check whether a ray hits any triangle of the hierarchy inside a given interval.
+
+The traversal stops at the first intersection found, which is much cheaper than
+finding the closest one for occlusion queries such as ambient occlusion.
+
+\param ray The ray (direction should be of unit length).
+\param tmin, tmax Interval.
+*/
+bool BVH::Occluded(const Ray &ray, double tmin, double tmax) const {
+    if (nodes.empty()) {
+        return false;
+    }
+
+    const Vector o = ray.Origin();
+    const Vector inv = ray.Direction().Inverse();
+
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node &node = nodes[stack[--top]];
+        if (!Slab(node, o, inv, tmin, tmax)) {
+            continue;
+        }
+
+        if (node.count > 0) {
+            if (packets[node.offset].Occluded(ray, tmin, tmax)) {
+                return true;
+            }
+        } else {
+            stack[top++] = node.offset;
+            stack[top++] = int(&node - nodes.data()) + 1;
+        }
+    }
+    return false;
+}
@@ -3,6 +3,7 @@
 //
 
 #include "capsule.h"
+#include "box.h"
 
 bool Capsule::IsInside(const Vector &p) const {
     return Cylinder::IsInside(p);
@@ -12,8 +13,71 @@ double Capsule::Volume() const {
     return (Math::PI()*r*r)*(((4.0/3.0)*r)+(h*2.0));
 }
 
+/**
+ * @return bounding box of the capsule, including the caps
+ */
+Box Capsule::GetBox() const {
+    return Box(c - Vector(r, r, h + r), c + Vector(r, r, h + r));
+}
+
+/**
+ * Signed distance to the capsule, which is the distance to its vertical segment minus the radius
+ * @param p point
+ * @return negative inside
+ */
+double Capsule::SignedDistance(const Vector &p) const {
+    Vector q = p - c;
+    q[2] -= Math::Clamp(q[2], -h, h);
+    return Norm(q) - r;
+}
+
+/**
+ * @param p point
+ * @param g returned gradient, the unit direction from the closest point of the axis
+ * @return signed distance to the capsule, negative inside
+ */
+double Capsule::SignedDistanceGradient(const Vector &p, Vector &g) const {
+    Vector q = p - c;
+    q[2] -= Math::Clamp(q[2], -h, h);
+    const double d = Norm(q);
+    g = d > 0.0 ? q / d : Vector::X;
+    return d - r;
+}
+
 Capsule::Capsule(const Vector &c, double h, double r) : Cylinder(c, h, r) {}
 
+/**
+ * Union of the interval with the line entry and exit depths of a sphere
+ * @param center center of the sphere
+ * @param r radius of the sphere
+ * @param ray ray
+ * @param hit true if a previous part has already been hit
+ * @param t0,t1 interval, enlarged on hit
+ */
+static void SphereInterval(const Vector &center, double r, const Ray &ray, bool &hit, double &t0, double &t1) {
+    Vector L = center - ray.Origin();
+    double tca = L * ray.Direction();
+    double ds = (L * L) - (tca * tca);
+    if (ds > r * r) return;
+    double thc = std::sqrt(r * r - ds);
+    t0 = hit ? Math::Min(t0, tca - thc) : tca - thc;
+    t1 = hit ? Math::Max(t1, tca + thc) : tca + thc;
+    hit = true;
+}
+
+/**
+ * The capsule is convex, its interval along the ray is the union of the intervals of the body and of the two caps
+ * @param ray ray
+ * @param d intersect distance, 0 if ray is inside
+ * @param d1 entry point distance, negative if ray is inside
+ * @param d2 exit point distance
+ * @return
+ */
 bool Capsule::Intersect(const Ray &ray, double &d, double &d1, double &d2) const {
-    return false;
+    bool hit = Interval(ray, d1, d2);
+    SphereInterval(c + Vector(0, 0, h), r, ray, hit, d1, d2);
+    SphereInterval(c - Vector(0, 0, h), r, ray, hit, d1, d2);
+    if (!hit || d2 < 0.0) return false;
+    d = Math::Max(d1, 0.0);
+    return true;
 }
@@ -3,6 +3,11 @@
 //
 
 #include "cylinder.h"
+#include "box.h"
+
+#include <cmath>
+#include <limits>
+#include <utility>
 
 bool Cylinder::IsInside(const Vector &p) const {
     return false;
@@ -16,6 +21,50 @@ double Cylinder::Volume() const {
     return Math::PI()*r*r*(h*2.0);
 }
 
+/**
+ * @return bounding box of the cylinder, whose axis is vertical
+ */
+Box Cylinder::GetBox() const {
+    return Box(c - Vector(r, r, h), c + Vector(r, r, h));
+}
+
+/**
+ * Signed distance to the cylinder, including its caps
+ * @param p point
+ * @return negative inside
+ */
+double Cylinder::SignedDistance(const Vector &p) const {
+    const Vector q = p - c;
+    const double x = std::sqrt(q[0] * q[0] + q[1] * q[1]) - r;
+    const double z = std::fabs(q[2]) - h;
+    const double ox = Math::Max(x, 0.0);
+    const double oz = Math::Max(z, 0.0);
+    return Math::Min(Math::Max(x, z), 0.0) + std::sqrt(ox * ox + oz * oz);
+}
+
+/**
+ * @param p point
+ * @param g returned gradient, toward the closest point of the side or of a cap
+ * @return signed distance to the cylinder, negative inside
+ */
+double Cylinder::SignedDistanceGradient(const Vector &p, Vector &g) const {
+    const Vector q = p - c;
+    const double l = std::sqrt(q[0] * q[0] + q[1] * q[1]);
+    const Vector radial = l > 0.0 ? Vector(q[0] / l, q[1] / l, 0.0) : Vector::X;
+    const Vector axial = q[2] < 0.0 ? -Vector::Z : Vector::Z;
+    const double x = l - r;
+    const double z = std::fabs(q[2]) - h;
+    if (x > 0.0 || z > 0.0) {
+        const double ox = Math::Max(x, 0.0);
+        const double oz = Math::Max(z, 0.0);
+        const double d = std::sqrt(ox * ox + oz * oz);
+        g = (ox * radial + oz * axial) / d;
+        return d;
+    }
+    g = x > z ? radial : axial;
+    return Math::Max(x, z);
+}
+
 void Cylinder::Translate(const Vector &v) {
 
 }
@@ -38,6 +87,55 @@ double Cylinder::getH() const {
 
 Cylinder::Cylinder(const Vector &c, double h, double r) : c(c), h(h), r(r) {}
 
+/**
+ * Compute the entry and exit depths of the line supporting a ray, the cylinder is vertical with its caps at c +/- h
+ * @param ray ray
+ * @param t0 entry depth, possibly negative
+ * @param t1 exit depth, possibly negative
+ * @return false if the line misses the cylinder
+ */
+bool Cylinder::Interval(const Ray &ray, double &t0, double &t1) const {
+    const Vector o = ray.Origin() - c;
+    const Vector dir = ray.Direction();
+
+    // Infinite cylinder
+    double a = dir[0] * dir[0] + dir[1] * dir[1];
+    double b = o[0] * dir[0] + o[1] * dir[1];
+    double k = o[0] * o[0] + o[1] * o[1] - r * r;
+    if (a < 1.0e-12) {
+        if (k > 0.0) return false;
+        t0 = -std::numeric_limits<double>::max();
+        t1 = std::numeric_limits<double>::max();
+    } else {
+        double delta = b * b - a * k;
+        if (delta < 0.0) return false;
+        delta = std::sqrt(delta);
+        t0 = (-b - delta) / a;
+        t1 = (-b + delta) / a;
+    }
+
+    // Slab between the caps
+    if (std::abs(dir[2]) < 1.0e-12) {
+        return std::abs(o[2]) <= h;
+    }
+    double z0 = (-h - o[2]) / dir[2];
+    double z1 = (h - o[2]) / dir[2];
+    if (z0 > z1) std::swap(z0, z1);
+    t0 = Math::Max(t0, z0);
+    t1 = Math::Min(t1, z1);
+    return t0 <= t1;
+}
+
+/**
+ *
+ * @param ray ray
+ * @param d intersect distance, 0 if ray is inside
+ * @param d1 entry point distance, negative if ray is inside
+ * @param d2 exit point distance
+ * @return
+ */
 bool Cylinder::Intersect(const Ray &ray, double &d, double &d1, double &d2) const {
-    return false;
+    if (!Interval(ray, d1, d2) || d2 < 0.0) return false;
+    d = Math::Max(d1, 0.0);
+    return true;
 }
@@ -0,0 +1,257 @@
+// Disk tree
+
+#include "disktree.h"
+
+#include <algorithm>
+
+const int DiskTree::leaf = 8;
+const double DiskTree::bias = 1.0e-1;
+
+/*!
+\class DiskTree disktree.h
+\brief Hierarchy of oriented disks approximating the surface of a mesh, for approximate ambient occlusion.
+
+Every vertex stands for an oriented disk whose area is a third of the area of its
+triangles, in the spirit of the dynamic ambient occlusion of Bunnell (GPU Gems 2).
+The occlusion of a vertex is the sum of the form factors of all the other disks,
+which is estimated in O(log n) by replacing distant clusters of disks with a single
+disk that has their total area, mean center and mean normal.
+
+Only disks facing the receiver occlude it. Occlusion is still counted twice where
+surfaces overlap as seen from a vertex, which may be lightened by a second pass in
+which the form factor of every disk is scaled by its own accessibility from the first
+pass, see SetAccessibility().
+
+\code
+DiskTree tree(mesh);
+double ao = 1.0 - tree.Occlusion(i, range, 2.0);
+\endcode
+*/
+
+/*!
+\brief Create the disks of all vertices and build the hierarchy.
+\param mesh The mesh.
+*/
+DiskTree::DiskTree(const Mesh &mesh) {
+    const int n = mesh.Vertexes();
+    disks.resize(n, {Vector::Null, Vector::Null, 0.0, 1.0});
+    for (int i = 0; i < n; i++) {
+        disks[i].p = mesh.Vertex(i);
+    }
+
+    // Vertex normals and areas from the triangles, area weighted, oriented as the normals of the mesh
+    // since the winding of the triangles is not consistent across meshes
+    const std::vector<FlatTriangle> &triangles = mesh.FlatTriangles();
+    for (int t = 0; t < int(triangles.size()); t++) {
+        const Vector e1(triangles[t].e1[0], triangles[t].e1[1], triangles[t].e1[2]);
+        const Vector e2(triangles[t].e2[0], triangles[t].e2[1], triangles[t].e2[2]);
+        const Vector an = 0.5 * (e1 / e2);
+        const double area = Norm(an) / 3.0;
+        for (int k = 0; k < 3; k++) {
+            Disk &disk = disks[mesh.VertexIndex(t, k)];
+            disk.n += (an * mesh.Normal(mesh.NormalIndex(t, k)) < 0.0) ? -an : an;
+            disk.area += area;
+        }
+    }
+    for (Disk &disk: disks) {
+        double length = Norm(disk.n);
+        disk.n = length > 0.0 ? disk.n / length : Vector::Null;
+    }
+
+    if (n == 0) {
+        return;
+    }
+
+    indexes.resize(n);
+    for (int i = 0; i < n; i++) {
+        indexes[i] = i;
+    }
+    nodes.reserve(2 * (n / leaf + 1));
+    Build(0, n);
+
+    // Sort disks by leaf
+    std::vector<Disk> sorted(n);
+    slots.resize(n);
+    for (int k = 0; k < n; k++) {
+        sorted[k] = disks[indexes[k]];
+        slots[indexes[k]] = k;
+    }
+    disks.swap(sorted);
+
+    Update(0);
+}
+
+/*!
+\brief Recursively build the node enclosing a range of disks, split at the median of their centers.
+\param first, last Range of disks.
+\return The index of the node.
+*/
+int DiskTree::Build(int first, int last) {
+    const int index = int(nodes.size());
+    nodes.push_back(Node());
+
+    Vector a = disks[indexes[first]].p;
+    Vector b = a;
+    for (int i = first + 1; i < last; i++) {
+        a = Vector::Min(a, disks[indexes[i]].p);
+        b = Vector::Max(b, disks[indexes[i]].p);
+    }
+    nodes[index].a = a;
+    nodes[index].b = b;
+
+    if (last - first <= leaf) {
+        nodes[index].offset = first;
+        nodes[index].count = last - first;
+        return index;
+    }
+
+    const Vector d = b - a;
+    const int axis = (d[0] > d[1] && d[0] > d[2]) ? 0 : (d[1] > d[2] ? 1 : 2);
+    const int middle = (first + last) / 2;
+    std::nth_element(indexes.begin() + first, indexes.begin() + middle, indexes.begin() + last, [&](int i, int j) {
+        return disks[i].p[axis] < disks[j].p[axis];
+    });
+
+    Build(first, middle);
+    int second = Build(middle, last);
+
+    nodes[index].offset = second;
+    nodes[index].count = 0;
+    return index;
+}
+
+/*!
+\brief Recursively compute the disk standing for a node from its disks or children.
+\param index Index of the node.
+*/
+void DiskTree::Update(int index) {
+    Node &node = nodes[index];
+    node.p = Vector::Null;
+    node.n = Vector::Null;
+    node.area = 0.0;
+    node.accessibility = 0.0;
+    node.radius = 0.0;
+
+    if (node.count > 0) {
+        for (int k = node.offset; k < node.offset + node.count; k++) {
+            node.p += disks[k].p * disks[k].area;
+            node.n += disks[k].n * disks[k].area;
+            node.area += disks[k].area;
+            node.accessibility += disks[k].accessibility * disks[k].area;
+        }
+    } else {
+        const int first = index + 1;
+        Update(first);
+        Update(node.offset);
+        for (const Node *child: {&nodes[first], &nodes[node.offset]}) {
+            node.p += child->p * child->area;
+            node.n += child->n * child->area;
+            node.area += child->area;
+            node.accessibility += child->accessibility * child->area;
+        }
+    }
+
+    if (node.area > 0.0) {
+        node.p = node.p / node.area;
+        node.n = node.n / node.area;
+        node.accessibility /= node.area;
+    } else {
+        node.p = 0.5 * (node.a + node.b);
+        node.accessibility = 1.0;
+    }
+
+    if (node.count > 0) {
+        for (int k = node.offset; k < node.offset + node.count; k++) {
+            double r = Norm(disks[k].p - node.p) + sqrt(disks[k].area / Math::PI());
+            node.radius = Math::Max(node.radius, r);
+        }
+    } else {
+        for (const Node *child: {&nodes[index + 1], &nodes[node.offset]}) {
+            node.radius = Math::Max(node.radius, Norm(child->p - node.p) + child->radius);
+        }
+    }
+}
+
+/*!
+\brief Set the accessibility of every disk, which scales its occlusion in the next evaluations.
+\param accessibility Accessibility, for every vertex.
+*/
+void DiskTree::SetAccessibility(const std::vector<double> &accessibility) {
+    for (int k = 0; k < int(disks.size()); k++) {
+        disks[k].accessibility = accessibility[indexes[k]];
+    }
+    if (!nodes.empty()) {
+        Update(0);
+    }
+}
+
+/*!
+\brief Compute the cosine-weighted fraction of the hemisphere of a receiver covered by an oriented disk.
+
+The solid angle of the disk is computed as if it was seen along its axis, and then scaled
+by the cosines at both ends, which is exact for small and distant disks.
+
+\param p, n Position and unit normal of the receiver.
+\param q, m Center and normal of the disk, the normal may be shorter than unit.
+\param area Area of the disk.
+*/
+inline double DiskTree::FormFactor(const Vector &p, const Vector &n, const Vector &q, const Vector &m, double area) {
+    Vector v = q - p;
+    const double d2 = v * v + 1.0e-16;
+    v = v / sqrt(d2);
+    const double cr = n * v;
+    const double ce = -(m * v);
+    if (cr <= 0.0 || ce <= 0.0) {
+        return 0.0;
+    }
+    return 2.0 * (1.0 - 1.0 / sqrt(1.0 + area / (Math::PI() * d2))) * ce * cr;
+}
+
+/*!
+\brief Compute the occlusion of a vertex by all the other disks.
+
+Clusters whose distance is larger than the threshold times their radius are approximated by a single disk,
+a larger threshold is more accurate and slower.
+
+\param i Index of the vertex.
+\param range Disks farther than this distance are ignored.
+\param threshold Opening threshold of the clusters, typically 2.
+\return The occlusion, which may exceed 1.
+*/
+double DiskTree::Occlusion(int i, double range, double threshold) const {
+    if (nodes.empty()) {
+        return 0.0;
+    }
+
+    // The receiver is offset along its normal as the origin of the rays of MeshColor::Accessibility()
+    const Disk &receiver = disks[slots[i]];
+    const Vector p = receiver.p + receiver.n * bias;
+    const Vector &n = receiver.n;
+
+    double occlusion = 0.0;
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node &node = nodes[stack[--top]];
+        const double d = Norm(node.p - p);
+        if (d - node.radius > range) {
+            continue;
+        }
+
+        if (d > threshold * node.radius) {
+            occlusion += FormFactor(p, n, node.p, node.n, node.area) * node.accessibility;
+        } else if (node.count > 0) {
+            for (int k = node.offset; k < node.offset + node.count; k++) {
+                if (indexes[k] == i || Norm(disks[k].p - p) > range) {
+                    continue;
+                }
+                occlusion += FormFactor(p, n, disks[k].p, disks[k].n, disks[k].area) * disks[k].accessibility;
+            }
+        } else {
+            stack[top++] = node.offset;
+            stack[top++] = int(&node - nodes.data()) + 1;
+        }
+    }
+    return occlusion;
+}
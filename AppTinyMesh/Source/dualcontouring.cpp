@@ -0,0 +1,443 @@
+// Dual contouring
+
+#include "dualcontouring.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+const double QEF::truncation = 0.1;
+
+/*!
+\class QEF dualcontouring.h
+\brief Quadratic error function of dual contouring.
+
+The function is the sum of the squared distances to a set of planes, each defined by a point
+and a unit normal. Only the normal equations are stored, so functions are merged by addition.
+*/
+
+/*!
+\brief Add a plane.
+\param p Point of the plane.
+\param n Unit normal.
+*/
+void QEF::Add(const Vector &p, const Vector &n) {
+    ata[0] += n[0] * n[0];
+    ata[1] += n[0] * n[1];
+    ata[2] += n[0] * n[2];
+    ata[3] += n[1] * n[1];
+    ata[4] += n[1] * n[2];
+    ata[5] += n[2] * n[2];
+
+    const double d = n * p;
+    atb[0] += n[0] * d;
+    atb[1] += n[1] * d;
+    atb[2] += n[2] * d;
+    btb += d * d;
+
+    mass += p;
+    count++;
+}
+
+/*!
+\brief Add all the planes of another function.
+\param q The function.
+*/
+void QEF::Add(const QEF &q) {
+    for (int i = 0; i < 6; i++) {
+        ata[i] += q.ata[i];
+    }
+    for (int i = 0; i < 3; i++) {
+        atb[i] += q.atb[i];
+    }
+    btb += q.btb;
+    mass += q.mass;
+    count += q.count;
+}
+
+/*!
+\brief Compute the sum of the squared distances from a point to the planes.
+\param x Point.
+*/
+double QEF::Error(const Vector &x) const {
+    const Vector ax(ata[0] * x[0] + ata[1] * x[1] + ata[2] * x[2],
+                    ata[1] * x[0] + ata[3] * x[1] + ata[4] * x[2],
+                    ata[2] * x[0] + ata[4] * x[1] + ata[5] * x[2]);
+    return Math::Max(x * ax - 2.0 * (x * Vector(atb[0], atb[1], atb[2])) + btb, 0.0);
+}
+
+/*!
+\brief Compute the point minimizing the function, closest to the mean of the points of the planes.
+
+The symmetric matrix is diagonalized with Jacobi rotations, and directions whose eigenvalue is small
+compared to the largest one are left to the mean point, which is the usual truncated pseudo inverse
+of dual contouring. Planes that are almost parallel therefore yield a point on a flat area, two sets
+of planes a point on a sharp edge, and three sets a point on a corner.
+
+\param cell Region of the point, the mean point is returned when the minimizer lies outside.
+*/
+Vector QEF::Solve(const Box &cell) const {
+    if (count == 0) {
+        return cell.Center();
+    }
+    const Vector m = mass / double(count);
+
+    double a[3][3] = {{ata[0], ata[1], ata[2]},
+                      {ata[1], ata[3], ata[4]},
+                      {ata[2], ata[4], ata[5]}};
+    double v[3][3] = {{1.0, 0.0, 0.0},
+                      {0.0, 1.0, 0.0},
+                      {0.0, 0.0, 1.0}};
+
+    // Jacobi rotations, a few sweeps are enough for a 3x3 matrix
+    static const int pairs[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+    for (int sweep = 0; sweep < 16; sweep++) {
+        if (a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2] < 1.0e-24) {
+            break;
+        }
+        for (const int *pq: pairs) {
+            const int p = pq[0];
+            const int q = pq[1];
+            if (std::fabs(a[p][q]) < 1.0e-30) {
+                continue;
+            }
+            const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+            const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+            const double c = 1.0 / std::sqrt(t * t + 1.0);
+            const double s = t * c;
+            for (int k = 0; k < 3; k++) {
+                const double akp = a[k][p];
+                const double akq = a[k][q];
+                a[k][p] = c * akp - s * akq;
+                a[k][q] = s * akp + c * akq;
+            }
+            for (int k = 0; k < 3; k++) {
+                const double apk = a[p][k];
+                const double aqk = a[q][k];
+                a[p][k] = c * apk - s * aqk;
+                a[q][k] = s * apk + c * aqk;
+            }
+            for (int k = 0; k < 3; k++) {
+                const double vkp = v[k][p];
+                const double vkq = v[k][q];
+                v[k][p] = c * vkp - s * vkq;
+                v[k][q] = s * vkp + c * vkq;
+            }
+        }
+    }
+
+    // Residual at the mean point
+    const Vector r = Vector(atb[0], atb[1], atb[2]) - Vector(ata[0] * m[0] + ata[1] * m[1] + ata[2] * m[2],
+                                                             ata[1] * m[0] + ata[3] * m[1] + ata[4] * m[2],
+                                                             ata[2] * m[0] + ata[4] * m[1] + ata[5] * m[2]);
+    const double largest = Math::Max(a[0][0], a[1][1], a[2][2]);
+    Vector x = m;
+    for (int i = 0; i < 3; i++) {
+        if (a[i][i] > truncation * largest && a[i][i] > 0.0) {
+            const Vector e(v[0][i], v[1][i], v[2][i]);
+            x += e * ((e * r) / a[i][i]);
+        }
+    }
+
+    const Vector lower = cell[0];
+    const Vector upper = cell[1];
+    for (int i = 0; i < 3; i++) {
+        if (x[i] < lower[i] || x[i] > upper[i]) {
+            return m;
+        }
+    }
+    return x;
+}
+
+/*!
+\class DualContouring dualcontouring.h
+\brief Dual contouring of implicit surfaces, which preserves sharp features.
+
+Every straddling edge of the grid yields a point on the surface and the normal at that point, the
+so called Hermite data. Every cell straddling the surface holds a single vertex minimizing the squared
+distance to the tangent planes of its edges, see QEF, and every straddling edge yields a quad joining the
+vertices of its four cells. Vertices snap to the sharp edges and corners of the surface, so that CSG shapes
+are captured at much lower resolutions than with marching cubes.
+
+Cells may be optionally clustered with an octree: the eight children of a node share a single vertex when
+the error of the merged function is below a tolerance, which removes triangles on flat areas.
+
+\code
+DualContouring contouring(tree);
+Mesh mesh;
+contouring.Polygonize(64, mesh, box, 1.0e-6);
+\endcode
+*/
+
+/*!
+\brief Create the polygonizer of a field.
+\param field The field, which should be kept alive.
+*/
+DualContouring::DualContouring(const AnalyticScalarField &field) : field(field) {
+}
+
+/*!
+\brief Compute the polygonal mesh approximating the implicit surface.
+
+The number of evaluations of the field is stored in the field, see AnalyticScalarField::Evaluations().
+
+\param n Discretization parameter, the number of vertices of the grid along every axis.
+\param g Returned geometry.
+\param box %Box defining the region that will be polygonized.
+\param tolerance Maximum error of the functions of clustered cells, cells are not clustered if 0.
+\param epsilon Epsilon value for computing points on straddling edges.
+*/
+void DualContouring::Polygonize(int n, Mesh &g, const Box &box, double tolerance, const double &epsilon) const {
+    const Vector o = box[0];
+    const Vector d = box.Diagonal() / (n - 1);
+    const int m = n - 1;
+    const int size = n * n;
+    auto point = [n](int i, int j, int k) { return (i * n + j) * n + k; };
+    auto lattice = [&](int i, int j, int k) { return o + Vector(i * d[0], j * d[1], k * d[2]); };
+
+    // Values at the vertices of the grid, evaluated plane by plane
+    std::vector<double> values(size_t(size) * n);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < n; i++) {
+        std::vector<Vector> plane(size);
+        for (int j = 0; j < n; j++) {
+            for (int k = 0; k < n; k++) {
+                plane[j * n + k] = lattice(i, j, k);
+            }
+        }
+        field.Values(plane.data(), values.data() + size_t(i) * size, size);
+    }
+
+    // Straddling edges, identified by their lower vertex and axis
+    std::vector<int> crossing[3];
+    std::vector<int> edges;
+    for (int axis = 0; axis < 3; axis++) {
+        crossing[axis].assign(size_t(size) * n, -1);
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            for (int k = 0; k < n; k++) {
+                const int p = point(i, j, k);
+                const int next[3] = {i + 1 < n ? point(i + 1, j, k) : -1, j + 1 < n ? point(i, j + 1, k) : -1,
+                                     k + 1 < n ? point(i, j, k + 1) : -1};
+                for (int axis = 0; axis < 3; axis++) {
+                    if (next[axis] != -1 && (values[p] < 0.0) != (values[next[axis]] < 0.0)) {
+                        crossing[axis][p] = int(edges.size());
+                        edges.push_back(p * 3 + axis);
+                    }
+                }
+            }
+        }
+    }
+
+    // Hermite data, normals are not counted as evaluations, see AnalyticScalarField::Evaluations()
+    std::vector<Vector> hp(edges.size());
+    std::vector<Vector> hn(edges.size());
+    long long count = (long long) (size) * n;
+#pragma omp parallel for schedule(dynamic, 64) reduction(+ : count)
+    for (int e = 0; e < int(edges.size()); e++) {
+        const int p = edges[e] / 3;
+        const int axis = edges[e] % 3;
+        const int i = p / size, j = (p / n) % n, k = p % n;
+        const int q = point(i + (axis == 0), j + (axis == 1), k + (axis == 2));
+        hp[e] = field.Root(lattice(i, j, k), lattice(i + (axis == 0), j + (axis == 1), k + (axis == 2)), values[p], values[q], d[axis], epsilon, count);
+        hn[e] = field.Normal(hp[e]);
+    }
+    field.evaluations = count;
+
+    // Origins and axes of the edges of a cell
+    static const int cube[12][4] = {
+            {0, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 1, 1, 0},
+            {0, 0, 0, 1}, {1, 0, 0, 1}, {0, 0, 1, 1}, {1, 0, 1, 1},
+            {0, 0, 0, 2}, {1, 0, 0, 2}, {0, 1, 0, 2}, {1, 1, 0, 2}
+    };
+
+    // Functions of the cells straddling the surface
+    std::vector<int> cells(size_t(m) * m * m, -1);
+    std::vector<QEF> qefs;
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < m; j++) {
+            for (int k = 0; k < m; k++) {
+                QEF qef;
+                for (const int *e: cube) {
+                    const int c = crossing[e[3]][point(i + e[0], j + e[1], k + e[2])];
+                    if (c != -1) {
+                        qef.Add(hp[c], hn[c]);
+                    }
+                }
+                if (qef.Count() > 0) {
+                    cells[(i * m + j) * m + k] = int(qefs.size());
+                    qefs.push_back(qef);
+                }
+            }
+        }
+    }
+
+    // Vertexes of the cells
+    std::vector<Vector> vertex;
+    std::vector<int> vertexes(qefs.size());
+    if (tolerance > 0.0) {
+        int extent = 1;
+        while (extent < m) {
+            extent *= 2;
+        }
+        QEF root;
+        bool collapsible;
+        Simplify(0, 0, 0, extent, m, cells, qefs, o, d, tolerance, vertexes, vertex, root, collapsible);
+        if (collapsible && root.Count() > 0) {
+            Cluster(0, 0, 0, extent, m, cells, root, o, d, vertexes, vertex);
+        }
+    } else {
+        vertex.resize(qefs.size());
+        std::iota(vertexes.begin(), vertexes.end(), 0);
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int i = 0; i < m; i++) {
+            for (int j = 0; j < m; j++) {
+                for (int k = 0; k < m; k++) {
+                    const int c = cells[(i * m + j) * m + k];
+                    if (c != -1) {
+                        vertex[c] = qefs[c].Solve(Box(lattice(i, j, k), lattice(i + 1, j + 1, k + 1)));
+                    }
+                }
+            }
+        }
+    }
+
+    // A quad joining the vertices of the four cells around every straddling edge, oriented towards positive values
+    std::vector<int> triangle;
+    for (int e = 0; e < int(edges.size()); e++) {
+        const int p = edges[e] / 3;
+        const int axis = edges[e] % 3;
+        const int c[3] = {p / size, (p / n) % n, p % n};
+        const int u = (axis + 1) % 3;
+        const int w = (axis + 2) % 3;
+        if (c[u] == 0 || c[w] == 0 || c[u] == m || c[w] == m) {
+            continue;
+        }
+
+        static const int around[4][2] = {{-1, -1}, {0, -1}, {0, 0}, {-1, 0}};
+        int quad[4];
+        for (int h = 0; h < 4; h++) {
+            int x[3] = {c[0], c[1], c[2]};
+            x[u] += around[h][0];
+            x[w] += around[h][1];
+            quad[h] = vertexes[cells[(x[0] * m + x[1]) * m + x[2]]];
+        }
+        if (values[p] >= 0.0) {
+            std::swap(quad[1], quad[3]);
+        }
+
+        // Split along the diagonal that does not collapse, and skip degenerate triangles of clustered cells
+        const int s = quad[0] == quad[2] ? 1 : 0;
+        const int t[2][3] = {{quad[s], quad[s + 1], quad[(s + 2) % 4]}, {quad[s], quad[(s + 2) % 4], quad[(s + 3) % 4]}};
+        for (const int *tri: t) {
+            if (tri[0] != tri[1] && tri[1] != tri[2] && tri[2] != tri[0]) {
+                triangle.insert(triangle.end(), tri, tri + 3);
+            }
+        }
+    }
+
+    std::vector<Vector> normal(vertex.size());
+#pragma omp parallel for schedule(dynamic, 256)
+    for (int i = 0; i < int(vertex.size()); i++) {
+        normal[i] = field.Normal(vertex[i]);
+    }
+
+    std::vector<int> normals = triangle;
+
+    g = Mesh(vertex, normal, triangle, normals);
+}
+
+/*!
+\brief Recursively merge the functions of the cells of an octree node.
+
+A node is collapsible when all its children are, and the error of their merged function at its minimizer is
+below the tolerance. The vertexes of the collapsible children of a node that is not collapsible are created.
+
+\param x, y, z Lower cell of the node.
+\param extent Number of cells of the node along every axis, a power of two.
+\param m Number of cells of the grid along every axis.
+\param cells Index of the function of every cell, -1 for cells that do not straddle the surface.
+\param qefs Functions.
+\param o Lower vertex of the grid.
+\param d Diagonal of a cell.
+\param tolerance Maximum error.
+\param vertexes Returned vertex of every function.
+\param vertex Returned vertexes.
+\param qef Returned merged function of the node.
+\param collapsible Returned status of the node.
+*/
+void DualContouring::Simplify(int x, int y, int z, int extent, int m, const std::vector<int> &cells,
+                              std::vector<QEF> &qefs, const Vector &o, const Vector &d, double tolerance,
+                              std::vector<int> &vertexes, std::vector<Vector> &vertex, QEF &qef, bool &collapsible) const {
+    qef = QEF();
+    collapsible = true;
+    if (x >= m || y >= m || z >= m) {
+        return;
+    }
+    if (extent == 1) {
+        const int c = cells[(x * m + y) * m + z];
+        if (c != -1) {
+            qef = qefs[c];
+        }
+        return;
+    }
+
+    const int half = extent / 2;
+    QEF children[8];
+    bool status[8];
+    for (int h = 0; h < 8; h++) {
+        Simplify(x + (h & 1) * half, y + ((h >> 1) & 1) * half, z + ((h >> 2) & 1) * half, half, m, cells, qefs, o, d,
+                 tolerance, vertexes, vertex, children[h], status[h]);
+        collapsible = collapsible && status[h];
+        qef.Add(children[h]);
+    }
+
+    if (collapsible && qef.Count() > 0) {
+        const Box region(o + Vector(x * d[0], y * d[1], z * d[2]),
+                         o + Vector(std::min(x + extent, m) * d[0], std::min(y + extent, m) * d[1], std::min(z + extent, m) * d[2]));
+        collapsible = qef.Error(qef.Solve(region)) <= tolerance;
+    }
+    if (collapsible) {
+        return;
+    }
+
+    for (int h = 0; h < 8; h++) {
+        if (status[h] && children[h].Count() > 0) {
+            Cluster(x + (h & 1) * half, y + ((h >> 1) & 1) * half, z + ((h >> 2) & 1) * half, half, m, cells,
+                    children[h], o, d, vertexes, vertex);
+        }
+    }
+}
+
+/*!
+\brief Create the vertex shared by all the cells of an octree node.
+\param x, y, z Lower cell of the node.
+\param extent Number of cells of the node along every axis.
+\param m Number of cells of the grid along every axis.
+\param cells Index of the function of every cell.
+\param qef Merged function of the node.
+\param o Lower vertex of the grid.
+\param d Diagonal of a cell.
+\param vertexes Returned vertex of every function of the node.
+\param vertex Vertexes, the new vertex is appended.
+*/
+void DualContouring::Cluster(int x, int y, int z, int extent, int m, const std::vector<int> &cells, const QEF &qef,
+                             const Vector &o, const Vector &d, std::vector<int> &vertexes, std::vector<Vector> &vertex) const {
+    const int xb = std::min(x + extent, m);
+    const int yb = std::min(y + extent, m);
+    const int zb = std::min(z + extent, m);
+    const Box region(o + Vector(x * d[0], y * d[1], z * d[2]), o + Vector(xb * d[0], yb * d[1], zb * d[2]));
+    vertex.push_back(qef.Solve(region));
+
+    for (int i = x; i < xb; i++) {
+        for (int j = y; j < yb; j++) {
+            for (int k = z; k < zb; k++) {
+                const int c = cells[(i * m + j) * m + k];
+                if (c != -1) {
+                    vertexes[c] = int(vertex.size()) - 1;
+                }
+            }
+        }
+    }
+}
@@ -1,6 +1,42 @@
 #include "implicits.h"
+#include "trianglesink.h"
 
-const double AnalyticScalarField::Epsilon = 1e-6;
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+const double AnalyticScalarField::Epsilon = Math::DifferenceStep();
+
+/*!
+\brief Resize a scratch buffer, keeping its capacity when it is large enough.
+\param v The buffer.
+\param n Size.
+\return 1 if the buffer had to grow, 0 otherwise.
+*/
+template<typename T>
+static int Fit(std::vector<T>& v, size_t n)
+{
+  const int grown = n > v.capacity() ? 1 : 0;
+  v.resize(n);
+  return grown;
+}
+
+/*!
+\brief Reserve a buffer.
+\param v The buffer.
+\param n Capacity.
+\return 1 if the buffer had to grow, 0 otherwise.
+*/
+template<typename T>
+static int Reserve(std::vector<T>& v, size_t n)
+{
+  if (n <= v.capacity())
+  {
+    return 0;
+  }
+  v.reserve(n);
+  return 1;
+}
 
 /*!
 \brief Constructor.
@@ -11,6 +47,9 @@ AnalyticScalarField::AnalyticScalarField()
 
 /*!
 \brief Compute the value of the field.
+
+The default field is the signed distance to the unit sphere centered at the origin.
+
 \param p Point.
 */
 double AnalyticScalarField::Value(const Vector& p) const
@@ -18,9 +57,31 @@ double AnalyticScalarField::Value(const Vector& p) const
   return Norm(p) - 1.0;
 }
 
+/*!
+\brief Compute the value of the field at an array of points.
+
+This function may be overridden with vectorized kernels, it is called by the polygonizers for
+whole planes of the grid. The default implementation calls Value() for every point.
+
+\param p Points.
+\param v Returned values.
+\param n Number of points.
+*/
+void AnalyticScalarField::Values(const Vector* p, double* v, int n) const
+{
+  for (int i = 0; i < n; i++)
+  {
+    v[i] = Value(p[i]);
+  }
+}
+
 /*!
 \brief Compute the polygonal mesh approximating the implicit surface.
 
+The grid is split into slabs of layers of cells which are polygonized in parallel when OpenMP is enabled.
+Vertexes on the edges of the plane shared by two slabs are only created by the lower slab, and the triangles
+of the upper slab are stitched to them, so that the mesh is the same as if the layers were swept serially.
+
 \param box %Box defining the region that will be polygonized.
 \param n Discretization parameter.
 \param g Returned geometry.
@@ -28,63 +89,254 @@ double AnalyticScalarField::Value(const Vector& p) const
 */
 void AnalyticScalarField::Polygonize(int n, Mesh& g, const Box& box, const double& epsilon) const
 {
-  std::vector<Vector> vertex;
-  std::vector<Vector> normal;
+  Polygonizer polygonizer;
+  polygonizer.Polygonize(*this, n, g, box, epsilon);
+}
 
+/*!
+\class Polygonizer implicits.h
+\brief Marching cubes polygonizer that keeps its scratch buffers from one call to the next.
+
+The slabs of AnalyticScalarField::Polygonize() and their planes are kept, and the geometry buffers of the slabs
+are reserved from the density of the previous polygonization, so that repeated polygonizations, for instance
+when sweeping the parameters of a field, do not allocate anything but the returned mesh once the buffers have grown.
+
+\code
+Polygonizer polygonizer;
+for (double r = 0.5; r < 1.0; r += 0.01)
+{
+  field.SetRadius(r);
+  polygonizer.Polygonize(field, 128, mesh, box);
+}
+\endcode
+*/
+
+/*!
+\brief Compute the polygonal mesh approximating the implicit surface, see AnalyticScalarField::Polygonize().
+\param field The field.
+\param n Discretization parameter.
+\param g Returned geometry.
+\param box %Box defining the region that will be polygonized.
+\param epsilon Epsilon value for computing vertices on straddling edges.
+*/
+void Polygonizer::Polygonize(const AnalyticScalarField& field, int n, Mesh& g, const Box& box, const double& epsilon)
+{
+  const int nz = n;
+
+  // Diagonal of a cell
+  Vector d = box.Diagonal() / (n - 1);
+
+  // Heights of the planes, accumulated as in a serial sweep so that all slabs agree on the shared planes
+  allocations = Fit(z, nz + 1);
+  z[0] = 0.0;
+  for (int k = 0; k < nz; k++)
+  {
+    z[k + 1] = z[k] + d[2];
+  }
+
+  // Several slabs per thread, since slabs that do not straddle the surface are much cheaper
+  const int threads = std::max(1, int(std::thread::hardware_concurrency()));
+  const int slabs = std::max(1, std::min(4 * threads, nz / 8));
+  allocations += Fit(slab, slabs);
+  allocations += Fit(offset, slabs + 1);
+  allocations += Fit(start, slabs + 1);
+
+  // Expected number of vertexes per layer from the previous call, as the area of the surface grows with the square of the resolution,
+  // slabs keep their own statistics when the resolution is the same
+  const double density = resolution > 0 ? vertexes * double(n) / (double(resolution) * double(resolution)) : 0.0;
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int s = 0; s < slabs; s++)
+  {
+    const int k0 = s * nz / slabs;
+    const int k1 = (s + 1) * nz / slabs;
+    const size_t previous = resolution == n ? slab[s].vertex.size() : size_t(density * (k1 - k0));
+    const size_t expected = previous + previous / 4;
+    slab[s].Clear();
+    slab[s].allocations += Reserve(slab[s].vertex, expected) + Reserve(slab[s].normal, expected) + Reserve(slab[s].triangle, 6 * expected);
+    field.PolygonizeSlab(n, k0, k1, box[0], d, z, epsilon, slab[s]);
+  }
+
+  // Concatenate slabs
+  offset[0] = start[0] = 0;
+  field.evaluations = 0;
+  for (int s = 0; s < slabs; s++)
+  {
+    offset[s + 1] = offset[s] + int(slab[s].vertex.size());
+    start[s + 1] = start[s] + int(slab[s].triangle.size());
+    field.evaluations += slab[s].evaluations;
+    allocations += slab[s].allocations;
+  }
+  total += allocations;
+  resolution = n;
+  vertexes = offset[slabs];
+  triangles = start[slabs] / 3;
+
+  std::vector<Vector> vertex(offset[slabs]);
+  std::vector<Vector> normal(offset[slabs]);
+  std::vector<int> triangle(start[slabs]);
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int s = 0; s < slabs; s++)
+  {
+    std::copy(slab[s].vertex.begin(), slab[s].vertex.end(), vertex.begin() + offset[s]);
+    std::copy(slab[s].normal.begin(), slab[s].normal.end(), normal.begin() + offset[s]);
+
+    // Stitch vertexes on the lower plane to the top plane of the previous slab
+    const int top = s > 0 ? offset[s - 1] + slab[s - 1].top : 0;
+    for (int i = 0; i < int(slab[s].triangle.size()); i++)
+    {
+      const int e = slab[s].triangle[i];
+      triangle[start[s] + i] = e >= 0 ? offset[s] + e : top - e - 1;
+    }
+  }
+
+  std::vector<int> normals = triangle;
+
+  g = Mesh(std::move(vertex), std::move(normal), std::move(triangle), std::move(normals));
+}
+
+/*!
+\brief Compute the polygonal mesh approximating the implicit surface, streamed to a sink by batches of slabs.
+
+The grid and the mesh are the same as those of Polygonize(). Slabs of a fixed number of layers of cells are
+polygonized in parallel, one per thread, then sent in order to the sink and cleared before the next batch
+is computed. Memory therefore only depends on the area of a slab and not on the size of the mesh, which
+may be written to a file or uploaded to the GPU as it is produced.
+
+\param n Discretization parameter.
+\param sink Receiver of the vertexes and triangles.
+\param box %Box defining the region that will be polygonized.
+\param layers Number of layers of cells of a slab.
+\param epsilon Epsilon value for computing vertices on straddling edges.
+*/
+void AnalyticScalarField::PolygonizeStream(int n, TriangleSink& sink, const Box& box, int layers, const double& epsilon) const
+{
+  const int nz = n;
+
+  // Diagonal of a cell
+  Vector d = box.Diagonal() / (n - 1);
+
+  // Heights of the planes, accumulated as in Polygonize()
+  std::vector<double> z(nz + 1);
+  z[0] = 0.0;
+  for (int k = 0; k < nz; k++)
+  {
+    z[k + 1] = z[k] + d[2];
+  }
+
+  layers = std::max(1, layers);
+  const int threads = std::max(1, int(std::thread::hardware_concurrency()));
+  const int slabs = (nz + layers - 1) / layers;
+  std::vector<Slab> slab(std::min(threads, slabs));
   std::vector<int> triangle;
 
-  vertex.reserve(20000);
-  normal.reserve(20000);
-  triangle.reserve(20000);
+  evaluations = 0;
+
+  // Number of vertexes sent, and index of the first vertex on the top plane of the last slab sent
+  int sent = 0;
+  int top = 0;
+
+  for (int first = 0; first < slabs; first += int(slab.size()))
+  {
+    const int batch = std::min(int(slab.size()), slabs - first);
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int s = 0; s < batch; s++)
+    {
+      slab[s].Clear();
+      PolygonizeSlab(n, (first + s) * layers, std::min((first + s + 1) * layers, nz), box[0], d, z, epsilon, slab[s]);
+    }
+
+    for (int s = 0; s < batch; s++)
+    {
+      // Stitch vertexes on the lower plane to the top plane of the previous slab
+      triangle.resize(slab[s].triangle.size());
+      for (int i = 0; i < int(triangle.size()); i++)
+      {
+        const int e = slab[s].triangle[i];
+        triangle[i] = e >= 0 ? sent + e : top - e - 1;
+      }
+
+      sink.Vertexes(slab[s].vertex.data(), slab[s].normal.data(), int(slab[s].vertex.size()));
+      sink.Triangles(triangle.data(), int(triangle.size()) / 3);
+
+      top = sent + slab[s].top;
+      sent += int(slab[s].vertex.size());
+      evaluations += slab[s].evaluations;
+    }
+  }
+
+  sink.Finish();
+}
+
+/*!
+\brief Polygonize a slab of layers of cells.
+
+Vertexes are indexed from the start of the slab. When the slab is not the first one, vertexes on the edges
+of its lower plane are not created, and triangles refer to them with negative indexes: the r-th straddling
+edge of the lower plane, in the order they are created on the top plane of the previous slab, is -1-r.
+
+\param n Discretization parameter.
+\param k0, k1 First and last (excluded) layers of cells.
+\param o Lower vertex of the grid.
+\param d Diagonal of a cell.
+\param z Height of every plane relative to the lower vertex.
+\param epsilon Epsilon value for computing vertices on straddling edges.
+\param slab Returned vertexes and triangles.
+*/
+void AnalyticScalarField::PolygonizeSlab(int n, int k0, int k1, const Vector& o, const Vector& d, const std::vector<double>& z, const double& epsilon, Slab& slab) const
+{
+  std::vector<Vector>& vertex = slab.vertex;
+  std::vector<Vector>& normal = slab.normal;
+  std::vector<int>& triangle = slab.triangle;
+  const size_t capacity[3] = { vertex.capacity(), normal.capacity(), triangle.capacity() };
 
   int nv = 0;
   const int nx = n;
   const int ny = n;
-  const int nz = n;
-
-  Box clipped = box;
 
   // Clamped integer values
   const int nax = 0;
   const int nbx = nx;
   const int nay = 0;
   const int nby = ny;
-  const int naz = 0;
-  const int nbz = nz;
 
   const int size = nx * ny;
 
   // Intensities
-  double* a = new double[size];
-  double* b = new double[size];
+  std::vector<double>& a = slab.a;
+  std::vector<double>& b = slab.b;
+  slab.allocations += Fit(a, size) + Fit(b, size);
 
   // Vertex
-  Vector* u = new Vector[size];
-  Vector* v = new Vector[size];
+  std::vector<Vector>& u = slab.u;
+  std::vector<Vector>& v = slab.v;
+  slab.allocations += Fit(u, size) + Fit(v, size);
 
   // Edges
-  int* eax = new int[size];
-  int* eay = new int[size];
-  int* ebx = new int[size];
-  int* eby = new int[size];
-  int* ez = new int[size];
+  std::vector<int>& eax = slab.eax;
+  std::vector<int>& eay = slab.eay;
+  std::vector<int>& ebx = slab.ebx;
+  std::vector<int>& eby = slab.eby;
+  std::vector<int>& ez = slab.ez;
+  slab.allocations += Fit(eax, size) + Fit(eay, size) + Fit(ebx, size) + Fit(eby, size) + Fit(ez, size);
 
-  // Diagonal of a cell
-  Vector d = clipped.Diagonal() / (n - 1);
-
-  double za = 0.0;
+  double za = z[k0];
 
   // Compute field inside lower Oxy plane
   for (int i = nax; i < nbx; i++)
   {
     for (int j = nay; j < nby; j++)
     {
-      u[i * ny + j] = clipped[0] + Vector(i * d[0], j * d[1], za);
-      a[i * ny + j] = Value(u[i * ny + j]);
+      u[i * ny + j] = o + Vector(i * d[0], j * d[1], za);
     }
   }
+  Values(u.data(), a.data(), size);
+  slab.evaluations += size;
 
-  // Compute straddling edges inside lower Oxy plane
+  // Compute straddling edges inside lower Oxy plane, only indexed if they belong to the previous slab
+  int r = 0;
   for (int i = nax; i < nbx - 1; i++)
   {
     for (int j = nay; j < nby; j++)
@@ -92,7 +344,12 @@ void AnalyticScalarField::Polygonize(int n, Mesh& g, const Box& box, const doubl
       // We need a xor b, which can be implemented a == !b 
       if (!((a[i * ny + j] < 0.0) == !(a[(i + 1) * ny + j] >= 0.0)))
       {
-        vertex.push_back(Dichotomy(u[i * ny + j], u[(i + 1) * ny + j], a[i * ny + j], a[(i + 1) * ny + j], d[0], epsilon));
+        if (k0 > 0)
+        {
+          eax[i * ny + j] = -(++r);
+          continue;
+        }
+        vertex.push_back(Root(u[i * ny + j], u[(i + 1) * ny + j], a[i * ny + j], a[(i + 1) * ny + j], d[0], epsilon, slab.evaluations));
         normal.push_back(Normal(vertex.back()));
         eax[i * ny + j] = nv;
         nv++;
@@ -105,7 +362,12 @@ void AnalyticScalarField::Polygonize(int n, Mesh& g, const Box& box, const doubl
     {
       if (!((a[i * ny + j] < 0.0) == !(a[i * ny + (j + 1)] >= 0.0)))
       {
-        vertex.push_back(Dichotomy(u[i * ny + j], u[i * ny + (j + 1)], a[i * ny + j], a[i * ny + (j + 1)], d[1], epsilon));
+        if (k0 > 0)
+        {
+          eay[i * ny + j] = -(++r);
+          continue;
+        }
+        vertex.push_back(Root(u[i * ny + j], u[i * ny + (j + 1)], a[i * ny + j], a[i * ny + (j + 1)], d[1], epsilon, slab.evaluations));
         normal.push_back(Normal(vertex.back()));
         eay[i * ny + j] = nv;
         nv++;
@@ -117,17 +379,24 @@ void AnalyticScalarField::Polygonize(int n, Mesh& g, const Box& box, const doubl
   int e[12];
 
   // For all layers
-  for (int k = naz; k < nbz; k++)
+  for (int k = k0; k < k1; k++)
   {
-    double zb = za + d[2];
+    double zb = z[k + 1];
     for (int i = nax; i < nbx; i++)
     {
       for (int j = nay; j < nby; j++)
       {
-        v[i * ny + j] = clipped[0] + Vector(i * d[0], j * d[1], zb);
-        b[i * ny + j] = Value(v[i * ny + j]);
+        v[i * ny + j] = o + Vector(i * d[0], j * d[1], zb);
       }
     }
+    Values(v.data(), b.data(), size);
+    slab.evaluations += size;
+
+    // Vertexes on the top plane of the slab are shared with the next slab
+    if (k == k1 - 1)
+    {
+      slab.top = nv;
+    }
 
     // Compute straddling edges inside lower Oxy plane
     for (int i = nax; i < nbx - 1; i++)
@@ -137,7 +406,7 @@ void AnalyticScalarField::Polygonize(int n, Mesh& g, const Box& box, const doubl
         //   if (((b[i*ny + j] < 0.0) && (b[(i + 1)*ny + j] >= 0.0)) || ((b[i*ny + j] >= 0.0) && (b[(i + 1)*ny + j] < 0.0)))
         if (!((b[i * ny + j] < 0.0) == !(b[(i + 1) * ny + j] >= 0.0)))
         {
-          vertex.push_back(Dichotomy(v[i * ny + j], v[(i + 1) * ny + j], b[i * ny + j], b[(i + 1) * ny + j], d[0], epsilon));
+          vertex.push_back(Root(v[i * ny + j], v[(i + 1) * ny + j], b[i * ny + j], b[(i + 1) * ny + j], d[0], epsilon, slab.evaluations));
           normal.push_back(Normal(vertex.back()));
           ebx[i * ny + j] = nv;
           nv++;
@@ -152,7 +421,7 @@ void AnalyticScalarField::Polygonize(int n, Mesh& g, const Box& box, const doubl
         // if (((b[i*ny + j] < 0.0) && (b[i*ny + (j + 1)] >= 0.0)) || ((b[i*ny + j] >= 0.0) && (b[i*ny + (j + 1)] < 0.0)))
         if (!((b[i * ny + j] < 0.0) == !(b[i * ny + (j + 1)] >= 0.0)))
         {
-          vertex.push_back(Dichotomy(v[i * ny + j], v[i * ny + (j + 1)], b[i * ny + j], b[i * ny + (j + 1)], d[1], epsilon));
+          vertex.push_back(Root(v[i * ny + j], v[i * ny + (j + 1)], b[i * ny + j], b[i * ny + (j + 1)], d[1], epsilon, slab.evaluations));
           normal.push_back(Normal(vertex.back()));
           eby[i * ny + j] = nv;
           nv++;
@@ -168,7 +437,7 @@ void AnalyticScalarField::Polygonize(int n, Mesh& g, const Box& box, const doubl
         // if ((a[i*ny + j] < 0.0) && (b[i*ny + j] >= 0.0) || (a[i*ny + j] >= 0.0) && (b[i*ny + j] < 0.0))
         if (!((a[i * ny + j] < 0.0) == !(b[i * ny + j] >= 0.0)))
         {
-          vertex.push_back(Dichotomy(u[i * ny + j], v[i * ny + j], a[i * ny + j], b[i * ny + j], d[2], epsilon));
+          vertex.push_back(Root(u[i * ny + j], v[i * ny + j], a[i * ny + j], b[i * ny + j], d[2], epsilon, slab.evaluations));
           normal.push_back(Normal(vertex.back()));
           ez[i * ny + j] = nv;
           nv++;
@@ -219,28 +488,230 @@ void AnalyticScalarField::Polygonize(int n, Mesh& g, const Box& box, const doubl
 
     std::swap(a, b);
 
-    za = zb;
     std::swap(eax, ebx);
     std::swap(eay, eby);
     std::swap(u, v);
   }
 
-  delete[]a;
-  delete[]b;
-  delete[]u;
-  delete[]v;
+  slab.allocations += int(vertex.capacity() != capacity[0]) + int(normal.capacity() != capacity[1]) + int(triangle.capacity() != capacity[2]);
+}
+
+/*!
+\brief Clear the geometry of the slab, keeping the capacity of all its buffers.
+*/
+void AnalyticScalarField::Slab::Clear()
+{
+  vertex.clear();
+  normal.clear();
+  triangle.clear();
+  top = 0;
+  evaluations = 0;
+  allocations = 0;
+}
+
+/*!
+\brief Compute the polygonal mesh approximating the implicit surface, only visiting cells close to the surface.
+
+The box is recursively subdivided as an octree over the cells of a grid with n points along every axis.
+An octree node is pruned when the value at its center is larger than the Lipschitz constant times its
+half diagonal, as the field cannot change sign inside. Marching cubes are run in the remaining cells
+only, so the number of field evaluations grows with the area of the surface instead of the volume of the box.
 
-  delete[]eax;
-  delete[]eay;
-  delete[]ebx;
-  delete[]eby;
-  delete[]ez;
+The triangles are the same as those of the dense grid of the same resolution, although vertexes are ordered
+differently. Contrary to Polygonize(), the grid does not extend one layer beyond the box.
+
+\sa Lipschitz()
+
+\param n Discretization parameter.
+\param g Returned geometry.
+\param box %Box defining the region that will be polygonized.
+\param epsilon Epsilon value for computing vertices on straddling edges.
+*/
+void AnalyticScalarField::PolygonizeSparse(int n, Mesh& g, const Box& box, const double& epsilon) const
+{
+  std::vector<Vector> vertex;
+  std::vector<Vector> normal;
+
+  std::vector<int> triangle;
+
+  // Diagonal of a cell
+  const Vector d = box.Diagonal() / (n - 1);
+  const Vector o = box[0];
+
+  // Cells that may straddle the surface
+  std::vector<long long> cells;
+  const int a[3] = { 0, 0, 0 };
+  const int b[3] = { n - 1, n - 1, n - 1 };
+  long long count = 0;
+  SparseCells(n, a, b, o, d, Lipschitz(), cells, count);
+
+  // Sort cells by layer along x with a counting sort, cells are identified by (i * n + j) * n + k
+  const long long size = (long long)(n) * n;
+  std::vector<int> first(n + 1, 0);
+  for (long long c : cells)
+  {
+    first[c / size + 1]++;
+  }
+  for (int i = 0; i < n; i++)
+  {
+    first[i + 1] += first[i];
+  }
+  std::vector<long long> sorted(cells.size());
+  {
+    std::vector<int> next(first.begin(), first.end() - 1);
+    for (long long c : cells)
+    {
+      sorted[next[c / size]++] = c;
+    }
+  }
+
+  // Values and straddling edges on the lower and upper plane of the current layer, only computed on demand and
+  // stamped with the index of their plane, so that the arrays need not be cleared when moving to the next layer
+  std::vector<double> va(size), vb(size);
+  std::vector<int> sa(size, -1), sb(size, -1);
+  std::vector<int> eay(size), eaz(size), eby(size), ebz(size), ex(size);
+  std::vector<int> say(size, -1), saz(size, -1), sby(size, -1), sbz(size, -1), sx(size, -1);
+
+  auto lattice = [&](int i, int j, int k) { return o + Vector(i * d[0], j * d[1], k * d[2]); };
+
+  // Origins and axes of the edges of a cell, in the order of the marching cubes tables
+  static const int edges[12][4] = {
+    { 0, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 1, 1, 0 },
+    { 0, 0, 0, 1 }, { 1, 0, 0, 1 }, { 0, 0, 1, 1 }, { 1, 0, 1, 1 },
+    { 0, 0, 0, 2 }, { 1, 0, 0, 2 }, { 0, 1, 0, 2 }, { 1, 1, 0, 2 }
+  };
+
+  for (int i = 0; i < n - 1; i++)
+  {
+    // Value at a vertex of the lower (l = 0) or upper (l = 1) plane
+    auto value = [&](int l, int j, int k) {
+      std::vector<double>& v = l == 0 ? va : vb;
+      std::vector<int>& s = l == 0 ? sa : sb;
+      if (s[j * n + k] != i + l)
+      {
+        v[j * n + k] = Value(lattice(i + l, j, k));
+        s[j * n + k] = i + l;
+        count++;
+      }
+      return v[j * n + k];
+    };
+
+    // Index of the vertex on an edge, created on demand
+    auto edge = [&](int l, int j, int k, int axis) {
+      std::vector<int>& e = axis == 0 ? ex : (axis == 1 ? (l == 0 ? eay : eby) : (l == 0 ? eaz : ebz));
+      std::vector<int>& s = axis == 0 ? sx : (axis == 1 ? (l == 0 ? say : sby) : (l == 0 ? saz : sbz));
+      if (s[j * n + k] != i + l)
+      {
+        const int lq = axis == 0 ? 1 : l;
+        const int jq = axis == 1 ? j + 1 : j;
+        const int kq = axis == 2 ? k + 1 : k;
+        vertex.push_back(Root(lattice(i + l, j, k), lattice(i + lq, jq, kq), value(l, j, k), value(lq, jq, kq), d[axis], epsilon, count));
+        normal.push_back(Normal(vertex.back()));
+        e[j * n + k] = int(vertex.size()) - 1;
+        s[j * n + k] = i + l;
+      }
+      return e[j * n + k];
+    };
+
+    for (int c = first[i]; c < first[i + 1]; c++)
+    {
+      const int j = int((sorted[c] / n) % n);
+      const int k = int(sorted[c] % n);
+
+      int cubeindex = 0;
+      for (int h = 0; h < 8; h++)
+      {
+        if (value(h & 1, j + ((h >> 1) & 1), k + ((h >> 2) & 1)) < 0.0) cubeindex |= 1 << h;
+      }
+
+      for (int h = 0; TriangleTable[cubeindex][h] != -1; h++)
+      {
+        const int* e = edges[TriangleTable[cubeindex][h]];
+        triangle.push_back(edge(e[0], j + e[1], k + e[2], e[3]));
+      }
+    }
+
+    std::swap(va, vb);
+    std::swap(sa, sb);
+    std::swap(eay, eby);
+    std::swap(say, sby);
+    std::swap(eaz, ebz);
+    std::swap(saz, sbz);
+  }
+
+  evaluations = count;
 
   std::vector<int> normals = triangle;
 
   g = Mesh(vertex, normal, triangle, normals);
 }
 
+/*!
+\brief Recursively collect the cells of an octree node that may straddle the surface.
+
+\param n Discretization parameter.
+\param a, b Lower and upper (excluded) cell indexes of the node along every axis.
+\param o Lower vertex of the grid.
+\param d Diagonal of a cell.
+\param lipschitz Lipschitz constant of the field.
+\param cells Returned cells, identified by the index of their lower vertex in the grid.
+\param count Number of evaluations, incremented.
+*/
+void AnalyticScalarField::SparseCells(int n, const int a[3], const int b[3], const Vector& o, const Vector& d, double lipschitz, std::vector<long long>& cells, long long& count) const
+{
+  count++;
+  const Vector pa = o + Vector(a[0] * d[0], a[1] * d[1], a[2] * d[2]);
+  const Vector pb = o + Vector(b[0] * d[0], b[1] * d[1], b[2] * d[2]);
+  if (fabs(Value(0.5 * (pa + pb))) > lipschitz * 0.5 * Norm(pb - pa))
+  {
+    return;
+  }
+
+  if (b[0] - a[0] == 1 && b[1] - a[1] == 1 && b[2] - a[2] == 1)
+  {
+    cells.push_back((((long long)a[0]) * n + a[1]) * n + a[2]);
+    return;
+  }
+
+  // Split every axis spanning several cells
+  const int m[3] = { (a[0] + b[0] + 1) / 2, (a[1] + b[1] + 1) / 2, (a[2] + b[2] + 1) / 2 };
+  for (int h = 0; h < 8; h++)
+  {
+    int ca[3], cb[3];
+    bool empty = false;
+    for (int i = 0; i < 3; i++)
+    {
+      const bool upper = (h >> i) & 1;
+      if (b[i] - a[i] == 1)
+      {
+        ca[i] = a[i];
+        cb[i] = b[i];
+        empty = empty || upper;
+      }
+      else
+      {
+        ca[i] = upper ? m[i] : a[i];
+        cb[i] = upper ? b[i] : m[i];
+      }
+    }
+    if (!empty)
+    {
+      SparseCells(n, ca, cb, o, d, lipschitz, cells, count);
+    }
+  }
+}
+
+/*!
+\brief Return the Lipschitz constant of the field, which bounds the norm of its gradient.
+
+Fields that are not signed distance bounds should override this function, since it is used for
+pruning empty space in PolygonizeSparse().
+*/
+double AnalyticScalarField::Lipschitz() const
+{
+  return 1.0;
+}
+
 /*!
 \brief Compute the intersection between a segment and an implicit surface.
 
@@ -277,17 +748,203 @@ Vector AnalyticScalarField::Dichotomy(Vector a, Vector b, double va, double vb,
 }
 
 
+/*!
+\brief Compute the intersection between a segment and an implicit surface with the selected root finding method.
+
+\sa SetRootFinding()
+
+\param a,b End vertices of the segment straddling the surface.
+\param va,vb Field function value at those end vertices.
+\param length Distance between vertices.
+\param epsilon Precision.
+\param count Number of evaluations, incremented by the evaluations of this function.
+\return Point on the implicit surface.
+*/
+Vector AnalyticScalarField::Root(const Vector& a, const Vector& b, double va, double vb, double length, const double& epsilon, long long& count) const
+{
+  // Get an accurate first guess
+  Vector c = (vb * a - va * b) / (vb - va);
+
+  switch (rootFinding)
+  {
+  case RootFinding::Linear:
+    return c;
+  case RootFinding::Bisection:
+  {
+    // Same as Dichotomy(), stopped after budget halvings, which never happens with the default unbounded budget
+    Vector x = a;
+    Vector y = b;
+    int ia = va > 0.0 ? 1 : -1;
+    for (int i = 0; i < budget && length > epsilon; i++)
+    {
+      double vc = Value(c);
+      count++;
+      int ic = vc > 0.0 ? 1 : -1;
+      if (ia + ic == 0)
+      {
+        y = c;
+      }
+      else
+      {
+        ia = ic;
+        x = c;
+      }
+      length *= 0.5;
+      c = 0.5 * (x + y);
+    }
+    return c;
+  }
+  case RootFinding::Illinois:
+  {
+    Vector x = a;
+    Vector y = b;
+    int side = 0;
+    for (int i = 0; i < budget; i++)
+    {
+      double vc = Value(c);
+      count++;
+      if (vc == 0.0)
+      {
+        return c;
+      }
+
+      // Halve the value of the end vertex that is kept twice in a row
+      if ((vc > 0.0) == (va > 0.0))
+      {
+        x = c;
+        va = vc;
+        if (side == -1) vb *= 0.5;
+        side = -1;
+      }
+      else
+      {
+        y = c;
+        vb = vc;
+        if (side == 1) va *= 0.5;
+        side = 1;
+      }
+
+      Vector next = (vb * x - va * y) / (vb - va);
+      double step = Norm(next - c);
+      c = next;
+      if (step < epsilon)
+      {
+        break;
+      }
+    }
+    return c;
+  }
+  case RootFinding::Newton:
+  {
+    // Parameterize the edge by the distance to the first end vertex, the interval [ta, tb] brackets the root
+    const Vector u = (b - a) / length;
+    double ta = 0.0;
+    double tb = length;
+    double t = length * va / (va - vb);
+    for (int i = 0; i < budget; i++)
+    {
+      c = a + u * t;
+      double vc = Value(c);
+      count++;
+      if (vc == 0.0)
+      {
+        return c;
+      }
+      if ((vc > 0.0) == (va > 0.0))
+      {
+        ta = t;
+      }
+      else
+      {
+        tb = t;
+      }
+
+      // Newton step along the edge, replaced by bisection when it leaves the bracket
+      double dv = Gradient(c) * u;
+      count += GradientCost();
+      double next = t - vc / dv;
+      if (!(next > ta && next < tb))
+      {
+        next = 0.5 * (ta + tb);
+      }
+      double step = fabs(next - t);
+      t = next;
+      if (step < epsilon)
+      {
+        break;
+      }
+    }
+    return a + u * t;
+  }
+  }
+  return c;
+}
+
 /*!
 \brief Compute the gradient of the field.
+
+The default implementation uses central differences, see CentralGradient(), so that fields only overriding
+Value() get correct gradients. Fields with a closed form gradient may override this function together with GradientCost().
+
 \param p Point.
 */
 Vector AnalyticScalarField::Gradient(const Vector& p) const
 {
-  double x = Value(Vector(p[0] + Epsilon, p[1], p[2])) - Value(Vector(p[0] - Epsilon, p[1], p[2]));
-  double y = Value(Vector(p[0], p[1] + Epsilon, p[2])) - Value(Vector(p[0], p[1] - Epsilon, p[2]));
-  double z = Value(Vector(p[0], p[1], p[2] + Epsilon)) - Value(Vector(p[0], p[1], p[2] - Epsilon));
+  return CentralGradient(p);
+}
+
+/*!
+\brief Return the cost of Gradient() in number of evaluations of the field, used for counting evaluations.
+
+The default gradient is computed with central differences and costs six evaluations. Fields overriding
+Gradient() with a closed form should return 1.
+*/
+int AnalyticScalarField::GradientCost() const
+{
+  return 6;
+}
+
+/*!
+\brief Compute the gradient of the field with central differences of step Math::DifferenceStep().
+
+The six evaluations are performed with a single call to Values().
+
+\param p Point.
+*/
+Vector AnalyticScalarField::CentralGradient(const Vector& p) const
+{
+  const Vector q[6] = {
+    Vector(p[0] + Epsilon, p[1], p[2]), Vector(p[0] - Epsilon, p[1], p[2]),
+    Vector(p[0], p[1] + Epsilon, p[2]), Vector(p[0], p[1] - Epsilon, p[2]),
+    Vector(p[0], p[1], p[2] + Epsilon), Vector(p[0], p[1], p[2] - Epsilon)
+  };
+  double v[6];
+  Values(q, v, 6);
+
+  return Vector(v[0] - v[1], v[2] - v[3], v[4] - v[5]) * (0.5 / Epsilon);
+}
+
+/*!
+\class SphereField implicits.h
+\brief Signed distance to the unit sphere centered at the origin, the default field, with its gradient in closed form.
+*/
+
+/*!
+\brief Compute the gradient of the field, which is the unit direction from the origin.
+\param p Point.
+*/
+Vector SphereField::Gradient(const Vector& p) const
+{
+  const double d = Norm(p);
+  return d > 0.0 ? p / d : Vector::Z;
+}
 
-  return Vector(x, y, z) * (0.5 / Epsilon);
+/*!
+\brief Return the cost of the gradient, a single evaluation as it is computed in closed form.
+*/
+int SphereField::GradientCost() const
+{
+  return 1;
 }
 
 /*!
@@ -0,0 +1,361 @@
+// Implicit modeling tree
+
+#include "implicittree.h"
+
+#include <algorithm>
+#include <cmath>
+
+/*!
+\class ImplicitTree implicittree.h
+\brief Scalar field defined by a tree of signed distance primitives combined with CSG and smooth blend operators.
+
+Every node stores the bounding box of its surface. Operators do not evaluate an operand when the point is
+farther from its box than the range over which the operand may change the result, and use the distance to
+the box instead, which is a lower bound of the distance to its surface with the same sign. Fields made of
+hundreds of primitives organized as balanced unions, see Union() and Blend(), are therefore evaluated in
+logarithmic time far from most primitives.
+
+\code
+std::shared_ptr<const ImplicitNode> a = std::make_shared<ImplicitPrimitive>(std::make_shared<Sphere>(Vector::Null, 1.0));
+std::shared_ptr<const ImplicitNode> b = std::make_shared<ImplicitPrimitive>(std::make_shared<Torus>(Vector::Null, 0.2, 1.0));
+ImplicitTree tree(std::make_shared<ImplicitBlend>(a, b, 0.3));
+Mesh mesh;
+tree.PolygonizeSparse(128, mesh, Box(tree.GetBox().Center(), 1.1 * tree.GetBox().Radius()));
+\endcode
+
+Values are signed distance bounds, so the field is 1-Lipschitz as long as transforms use uniform scales.
+Gradients are propagated through the operators along with values, so that a normal only costs a single
+traversal of the tree, see ImplicitNode::ValueGradient().
+*/
+
+/*!
+\brief Create a leaf from a primitive.
+\param primitive The primitive, which may be shared between several leaves.
+*/
+ImplicitPrimitive::ImplicitPrimitive(const std::shared_ptr<const Primitive> &primitive)
+    : ImplicitNode(primitive->GetBox()), primitive(primitive) {
+}
+
+/*!
+\brief Compute the signed distance to the primitive.
+\param p Point.
+*/
+double ImplicitPrimitive::Value(const Vector &p) const {
+    return primitive->SignedDistance(p);
+}
+
+/*!
+\brief Compute the signed distance to the primitive and its gradient.
+
+Built-in primitives compute their gradient in closed form, others fall back to central differences,
+see Primitive::SignedDistanceGradient().
+
+\param p Point.
+\param g Returned gradient.
+*/
+double ImplicitPrimitive::ValueGradient(const Vector &p, Vector &g) const {
+    return primitive->SignedDistanceGradient(p, g);
+}
+
+/*!
+\brief Create a binary operator.
+\param left, right Operands.
+\param box Bounding box of the result.
+*/
+ImplicitOperator::ImplicitOperator(const std::shared_ptr<const ImplicitNode> &left,
+                                   const std::shared_ptr<const ImplicitNode> &right, const Box &box)
+    : ImplicitNode(box), left(left), right(right) {
+}
+
+/*!
+\brief Create the union of two nodes.
+\param left, right Operands.
+*/
+ImplicitUnion::ImplicitUnion(const std::shared_ptr<const ImplicitNode> &left,
+                             const std::shared_ptr<const ImplicitNode> &right)
+    : ImplicitOperator(left, right, Box(left->GetBox(), right->GetBox())) {
+}
+
+/*!
+\brief Compute the value of the union, which is the minimum of the operands.
+\param p Point.
+*/
+double ImplicitUnion::Value(const Vector &p) const {
+    return Math::Min(left->Bounded(p), right->Bounded(p));
+}
+
+/*!
+\brief Compute the value of the union and its gradient, which is the gradient of the closest operand.
+\param p Point.
+\param g Returned gradient.
+*/
+double ImplicitUnion::ValueGradient(const Vector &p, Vector &g) const {
+    Vector gb;
+    const double a = left->BoundedGradient(p, g);
+    const double b = right->BoundedGradient(p, gb);
+    if (b < a) {
+        g = gb;
+        return b;
+    }
+    return a;
+}
+
+/*!
+\brief Create the intersection of two nodes.
+
+The box is the intersection of the boxes of the operands, reduced to a point on every axis where they do not overlap.
+
+\param left, right Operands.
+*/
+ImplicitIntersection::ImplicitIntersection(const std::shared_ptr<const ImplicitNode> &left,
+                                           const std::shared_ptr<const ImplicitNode> &right)
+    : ImplicitOperator(left, right, Box::Null) {
+    const Vector a = Vector::Max(left->GetBox()[0], right->GetBox()[0]);
+    const Vector b = Vector::Min(left->GetBox()[1], right->GetBox()[1]);
+    box = Box(a, Vector::Max(a, b));
+}
+
+/*!
+\brief Compute the value of the intersection, which is the maximum of the operands.
+\param p Point.
+*/
+double ImplicitIntersection::Value(const Vector &p) const {
+    return Math::Max(left->Bounded(p), right->Bounded(p));
+}
+
+/*!
+\brief Compute the value of the intersection and its gradient.
+\param p Point.
+\param g Returned gradient.
+*/
+double ImplicitIntersection::ValueGradient(const Vector &p, Vector &g) const {
+    Vector gb;
+    const double a = left->BoundedGradient(p, g);
+    const double b = right->BoundedGradient(p, gb);
+    if (b > a) {
+        g = gb;
+        return b;
+    }
+    return a;
+}
+
+/*!
+\brief Create the difference of two nodes.
+\param left Node.
+\param right Node removed from the first one.
+*/
+ImplicitDifference::ImplicitDifference(const std::shared_ptr<const ImplicitNode> &left,
+                                       const std::shared_ptr<const ImplicitNode> &right)
+    : ImplicitOperator(left, right, left->GetBox()) {
+}
+
+/*!
+\brief Compute the value of the difference, which is the maximum of the first operand and the opposite of the second.
+\param p Point.
+*/
+double ImplicitDifference::Value(const Vector &p) const {
+    return Math::Max(left->Bounded(p), -right->Bounded(p));
+}
+
+/*!
+\brief Compute the value of the difference and its gradient.
+\param p Point.
+\param g Returned gradient.
+*/
+double ImplicitDifference::ValueGradient(const Vector &p, Vector &g) const {
+    Vector gb;
+    const double a = left->BoundedGradient(p, g);
+    const double b = -right->BoundedGradient(p, gb);
+    if (b > a) {
+        g = -gb;
+        return b;
+    }
+    return a;
+}
+
+/*!
+\brief Create the smooth union of two nodes.
+
+The blend adds at most a quarter of its radius to the union, so the box is the box of the union enlarged accordingly.
+
+\param left, right Operands.
+\param radius Radius of the blend, strictly positive.
+*/
+ImplicitBlend::ImplicitBlend(const std::shared_ptr<const ImplicitNode> &left,
+                             const std::shared_ptr<const ImplicitNode> &right, double radius)
+    : ImplicitOperator(left, right, Box(left->GetBox(), right->GetBox())), radius(radius) {
+    box = Box(box[0] - Vector(0.25 * radius), box[1] + Vector(0.25 * radius));
+}
+
+/*!
+\brief Compute the value of the smooth union with a polynomial smooth minimum.
+
+Operands farther than the radius from their box are replaced by the distance to the box, which is
+at least the radius, so that the blend keeps the sign of the exact value.
+
+\param p Point.
+*/
+double ImplicitBlend::Value(const Vector &p) const {
+    const double a = left->Bounded(p, radius);
+    const double b = right->Bounded(p, radius);
+    const double h = Math::Max(radius - std::fabs(a - b), 0.0) / radius;
+    return Math::Min(a, b) - h * h * radius * 0.25;
+}
+
+/*!
+\brief Compute the value of the smooth union and its gradient, which blends the gradients of the operands.
+\param p Point.
+\param g Returned gradient.
+*/
+double ImplicitBlend::ValueGradient(const Vector &p, Vector &g) const {
+    Vector ga, gb;
+    const double a = left->BoundedGradient(p, ga, radius);
+    const double b = right->BoundedGradient(p, gb, radius);
+    const double h = Math::Max(radius - std::fabs(a - b), 0.0) / radius;
+
+    // Weight of the largest operand
+    const double w = 0.5 * h;
+    g = a < b ? (1.0 - w) * ga + w * gb : w * ga + (1.0 - w) * gb;
+    return Math::Min(a, b) - h * h * radius * 0.25;
+}
+
+/*!
+\brief Create a transformed node.
+
+The node is first scaled, then rotated and finally translated. Scales are uniform, so that values remain distances.
+
+\param node The node.
+\param translation Translation.
+\param rotation Rotation matrix.
+\param scale Scale, strictly positive.
+*/
+ImplicitTransform::ImplicitTransform(const std::shared_ptr<const ImplicitNode> &node, const Vector &translation,
+                                     const Matrix &rotation, double scale)
+    : ImplicitNode(Box::Null), node(node), inverse(Transpose(rotation)), translation(translation), scale(scale) {
+    const Box local = node->GetBox();
+    std::vector<Vector> corners(8);
+    for (int k = 0; k < 8; k++) {
+        corners[k] = rotation * (scale * local.Vertex(k)) + translation;
+    }
+    box = Box(corners);
+}
+
+/*!
+\brief Compute the value of the node in its own frame, scaled back to a distance in the parent frame.
+\param p Point.
+*/
+double ImplicitTransform::Value(const Vector &p) const {
+    return scale * node->Bounded(inverse * (p - translation) / scale);
+}
+
+/*!
+\brief Compute the value of the node and its gradient, rotated back to the parent frame.
+\param p Point.
+\param g Returned gradient.
+*/
+double ImplicitTransform::ValueGradient(const Vector &p, Vector &g) const {
+    Vector local;
+    const double v = scale * node->BoundedGradient(inverse * (p - translation) / scale, local);
+    g = Transpose(inverse) * local;
+    return v;
+}
+
+/*!
+\brief Create a field from a tree.
+\param root Root node.
+*/
+ImplicitTree::ImplicitTree(const std::shared_ptr<const ImplicitNode> &root) : root(root) {
+}
+
+/*!
+\brief Compute the value of the field.
+
+Outside the box of the root, this is the distance to the box.
+
+\param p Point.
+*/
+double ImplicitTree::Value(const Vector &p) const {
+    return root->Bounded(p);
+}
+
+/*!
+\brief Compute the gradient of the field with a single traversal of the tree.
+\param p Point.
+*/
+Vector ImplicitTree::Gradient(const Vector &p) const {
+    Vector g;
+    root->BoundedGradient(p, g);
+    return g;
+}
+
+/*!
+\brief Return the cost of the gradient, a single traversal of the tree as for Value().
+*/
+int ImplicitTree::GradientCost() const {
+    return 1;
+}
+
+/*!
+\brief Return the Lipschitz constant of the field, which is a signed distance bound.
+*/
+double ImplicitTree::Lipschitz() const {
+    return 1.0;
+}
+
+/*!
+\brief Create a balanced union of nodes, so that only the nodes close to a point are visited during evaluation.
+\param nodes Nodes, at least one.
+*/
+std::shared_ptr<const ImplicitNode> ImplicitTree::Union(const std::vector<std::shared_ptr<const ImplicitNode>> &nodes) {
+    std::vector<std::shared_ptr<const ImplicitNode>> sorted = nodes;
+    return Balanced(sorted, 0, int(sorted.size()), 0.0);
+}
+
+/*!
+\brief Create a balanced smooth union of nodes.
+
+Contrary to the union, the blend is not associative, so the result slightly depends on the organization of the tree.
+
+\param nodes Nodes, at least one.
+\param radius Radius of the blend.
+*/
+std::shared_ptr<const ImplicitNode> ImplicitTree::Blend(const std::vector<std::shared_ptr<const ImplicitNode>> &nodes,
+                                                        double radius) {
+    std::vector<std::shared_ptr<const ImplicitNode>> sorted = nodes;
+    return Balanced(sorted, 0, int(sorted.size()), radius);
+}
+
+/*!
+\brief Recursively combine a range of nodes, split at the median of the centers of their boxes.
+\param nodes Nodes, reordered.
+\param first, last Range of nodes.
+\param radius Radius of the blend, 0 for a union.
+*/
+std::shared_ptr<const ImplicitNode> ImplicitTree::Balanced(std::vector<std::shared_ptr<const ImplicitNode>> &nodes,
+                                                           int first, int last, double radius) {
+    if (last - first == 1) {
+        return nodes[first];
+    }
+
+    Vector cmin = nodes[first]->GetBox().Center();
+    Vector cmax = cmin;
+    for (int i = first + 1; i < last; i++) {
+        cmin = Vector::Min(cmin, nodes[i]->GetBox().Center());
+        cmax = Vector::Max(cmax, nodes[i]->GetBox().Center());
+    }
+
+    const Vector d = cmax - cmin;
+    const int axis = (d[0] > d[1] && d[0] > d[2]) ? 0 : (d[1] > d[2] ? 1 : 2);
+    const int middle = (first + last) / 2;
+    std::nth_element(nodes.begin() + first, nodes.begin() + middle, nodes.begin() + last,
+                     [axis](const std::shared_ptr<const ImplicitNode> &a, const std::shared_ptr<const ImplicitNode> &b) {
+                         return a->GetBox().Center()[axis] < b->GetBox().Center()[axis];
+                     });
+
+    const std::shared_ptr<const ImplicitNode> left = Balanced(nodes, first, middle, radius);
+    const std::shared_ptr<const ImplicitNode> right = Balanced(nodes, middle, last, radius);
+    if (radius > 0.0) {
+        return std::make_shared<ImplicitBlend>(left, right, radius);
+    }
+    return std::make_shared<ImplicitUnion>(left, right);
+}
@@ -10,6 +10,7 @@
 #include <QtCore/qdatetime.h>
 #include <QtGui/QPainter>
 
+#include <algorithm>
 #include <fstream>
 
 /*!
@@ -26,6 +27,7 @@ MeshWidget::MeshGL::MeshGL()
     fullBuffer = 0;
     indexBuffer = 0;
     triangleCount = 0;
+    aoOffset = 0;
     SetFrame(Vector::Null);
 }
 
@@ -38,8 +40,10 @@ MeshWidget::MeshGL::MeshGL(const Mesh& mesh, const Vector& position) : MeshGL()
     bbox = mesh.GetBox();
 
     // Compute plain arrays of sorted vertices & normals
-    std::vector<int> vertexIndexes = mesh.VertexIndexes();
-    std::vector<int> normalIndexes = mesh.NormalIndexes();
+    const View<int> vertexIndexes = mesh.VertexIndexView();
+    const View<int> normalIndexes = mesh.NormalIndexView();
+    const Vector* meshVertices = mesh.VertexData();
+    const Vector* meshNormals = mesh.NormalData();
     assert(vertexIndexes.size() == normalIndexes.size());
 
     int nbVertex = int(vertexIndexes.size());
@@ -51,12 +55,12 @@ MeshWidget::MeshGL::MeshGL(const Mesh& mesh, const Vector& position) : MeshGL()
         int indexVertex = vertexIndexes[i];
         int indexNormal = normalIndexes[i];
 
-        Vector vertex = mesh.Vertex(indexVertex);
+        const Vector& vertex = meshVertices[indexVertex];
         vertices[i * 3 + 0] = float(vertex[0]);
         vertices[i * 3 + 1] = float(vertex[1]);
         vertices[i * 3 + 2] = float(vertex[2]);
 
-        Vector normal = mesh.Normal(indexNormal);
+        const Vector& normal = meshNormals[indexNormal];
         normals[i * 3 + 0] = float(normal[0]);
         normals[i * 3 + 1] = float(normal[1]);
         normals[i * 3 + 2] = float(normal[2]);
@@ -117,10 +121,14 @@ MeshWidget::MeshGL::MeshGL(const MeshColor& mesh, const Vector& fr) : MeshGL()
     bbox = mesh.GetBox();
 
     // Compute plain arrays of sorted vertices & normals
-    std::vector<int> vertexIndexes = mesh.VertexIndexes();
-    std::vector<int> normalIndexes = mesh.NormalIndexes();
-    std::vector<int> colorIndexes = mesh.ColorIndexes();
-    std::vector<int> AOIndexes = mesh.AOIndexes();
+    const View<int> vertexIndexes = mesh.VertexIndexView();
+    const View<int> normalIndexes = mesh.NormalIndexView();
+    const View<int> colorIndexes = mesh.ColorIndexView();
+    const View<int> AOIndexes = mesh.AOIndexView();
+    const View<Color> meshColors = mesh.ColorView();
+    const View<Color> meshAO = mesh.AOView();
+    const Vector* meshVertices = mesh.VertexData();
+    const Vector* meshNormals = mesh.NormalData();
     assert(vertexIndexes.size() == normalIndexes.size());
 
     int nbVertex = int(vertexIndexes.size());
@@ -136,22 +144,22 @@ MeshWidget::MeshGL::MeshGL(const MeshColor& mesh, const Vector& fr) : MeshGL()
         int indexColor = colorIndexes[i];
         int indexAOColor = AOIndexes[i];
 
-        Vector vertex = mesh.Vertex(indexVertex);
+        const Vector& vertex = meshVertices[indexVertex];
         vertices[i * 3 + 0] = float(vertex[0]);
         vertices[i * 3 + 1] = float(vertex[1]);
         vertices[i * 3 + 2] = float(vertex[2]);
 
-        Vector normal = mesh.Normal(indexNormal);
+        const Vector& normal = meshNormals[indexNormal];
         normals[i * 3 + 0] = float(normal[0]);
         normals[i * 3 + 1] = float(normal[1]);
         normals[i * 3 + 2] = float(normal[2]);
 
-        Color color = mesh.GetColor(indexColor);
+        const Color& color = meshColors[indexColor];
         colors[i * 3 + 0] = float(color[0]);
         colors[i * 3 + 1] = float(color[1]);
         colors[i * 3 + 2] = float(color[2]);
 
-        Color AO = mesh.GetAO(indexAOColor);
+        const Color& AO = meshAO[indexAOColor];
         AOColors[i * 3 + 0] = float(AO[0]);
         AOColors[i * 3 + 1] = float(AO[1]);
         AOColors[i * 3 + 2] = float(AO[2]);
@@ -204,6 +212,7 @@ MeshWidget::MeshGL::MeshGL(const MeshColor& mesh, const Vector& fr) : MeshGL()
     // AO(3)
     offset = offset + size;
     size = sizeof(float) * singleBufferSize;
+    aoOffset = offset;
     glBufferSubData(GL_ARRAY_BUFFER, offset, size, AOColors);
     glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, (const void*)offset);
     glEnableVertexAttribArray(3);
@@ -221,6 +230,177 @@ MeshWidget::MeshGL::MeshGL(const MeshColor& mesh, const Vector& fr) : MeshGL()
     delete[] AOColors;
 }
 
+/*!
+\brief Constructor from the buffers of a sink, which are released by the sink.
+*/
+MeshWidget::MeshGL::MeshGL(GLBufferSink& sink, const Vector& position) : MeshGL()
+{
+    SetFrame(position);
+    bbox = sink.GetBox();
+
+    // Take ownership of the buffers
+    fullBuffer = sink.vertexBuffer;
+    indexBuffer = sink.indexBuffer;
+    triangleCount = int(sink.indexes);
+    sink.vertexBuffer = 0;
+    sink.indexBuffer = 0;
+    sink.vertexCapacity = sink.indexCapacity = 0;
+    sink.vertexes = sink.indexes = 0;
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    // Interleaved vertices(0) and normals(1)
+    glBindBuffer(GL_ARRAY_BUFFER, fullBuffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (const void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (const void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    // Triangles
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+}
+
+/*!
+\brief Constructor from a single precision mesh, whose arrays are uploaded without any conversion.
+*/
+MeshWidget::MeshGL::MeshGL(const MeshFloat& mesh, const Vector& position) : MeshGL()
+{
+    SetFrame(position);
+    bbox = mesh.GetBox();
+
+    const size_t singleBufferSize = sizeof(float) * 3 * mesh.Vertexes();
+    triangleCount = mesh.Triangles() * 3;
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &fullBuffer);
+    glGenBuffers(1, &indexBuffer);
+    glBindVertexArray(vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, fullBuffer);
+    glBufferData(GL_ARRAY_BUFFER, 2 * singleBufferSize, nullptr, GL_STATIC_DRAW);
+
+    // Vertices(0)
+    glBufferSubData(GL_ARRAY_BUFFER, 0, singleBufferSize, mesh.VertexData());
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (const void*)0);
+    glEnableVertexAttribArray(0);
+
+    // Normals(1)
+    glBufferSubData(GL_ARRAY_BUFFER, singleBufferSize, singleBufferSize, mesh.NormalData());
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (const void*)singleBufferSize);
+    glEnableVertexAttribArray(1);
+
+    // Triangles
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * triangleCount, mesh.IndexData(), GL_STATIC_DRAW);
+}
+
+/*!
+\class GLBufferSink realtime.h
+\brief Upload the batches of a streamed mesh directly to OpenGL buffers, see AnalyticScalarField::PolygonizeStream().
+
+Vertexes and normals are converted to single precision and interleaved in one buffer, triangles are stored
+in an index buffer. Buffers grow geometrically on the GPU and are copied there, so only the last batch is kept
+in CPU memory. The OpenGL context of the widget must be current while the sink receives batches, see
+QOpenGLWidget::makeCurrent(), and the buffers are then handed over with MeshWidget::AddMesh().
+*/
+
+/*!
+\brief Delete the buffers if they were not handed over to a widget.
+*/
+GLBufferSink::~GLBufferSink()
+{
+    if (vertexBuffer != 0)
+        glDeleteBuffers(1, &vertexBuffer);
+    if (indexBuffer != 0)
+        glDeleteBuffers(1, &indexBuffer);
+}
+
+/*!
+\brief Grow a buffer, keeping its content.
+
+Copy targets are used so that the bindings of the current vertex array object are not modified.
+
+\param buffer The buffer, created if 0.
+\param capacity Capacity in elements, updated.
+\param needed Requested number of elements.
+\param element Size of an element in bytes.
+*/
+void GLBufferSink::Reserve(GLuint& buffer, size_t& capacity, size_t needed, size_t element)
+{
+    if (needed <= capacity)
+        return;
+
+    const size_t grown = std::max(needed, 2 * capacity);
+    GLuint copy = 0;
+    glGenBuffers(1, &copy);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, copy);
+    glBufferData(GL_COPY_WRITE_BUFFER, grown * element, nullptr, GL_STATIC_DRAW);
+    if (buffer != 0)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, capacity * element);
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = copy;
+    capacity = grown;
+}
+
+/*!
+\brief Upload a batch of vertexes.
+\param v Vertexes.
+\param n Normals.
+\param count Number of vertexes.
+*/
+void GLBufferSink::Vertexes(const Vector* v, const Vector* n, int count)
+{
+    if (count == 0)
+        return;
+    if (vertexes == 0)
+        lower = upper = v[0];
+
+    staging.resize(size_t(count) * 6);
+    for (int i = 0; i < count; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            staging[i * 6 + j] = float(v[i][j]);
+            staging[i * 6 + 3 + j] = float(n[i][j]);
+        }
+        lower = Vector::Min(lower, v[i]);
+        upper = Vector::Max(upper, v[i]);
+    }
+
+    Reserve(vertexBuffer, vertexCapacity, vertexes + count, 6 * sizeof(float));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, vertexes * 6 * sizeof(float), staging.size() * sizeof(float), staging.data());
+    vertexes += count;
+}
+
+/*!
+\brief Upload a batch of triangles.
+\param t Vertex indexes, three per triangle.
+\param count Number of triangles.
+*/
+void GLBufferSink::Triangles(const int* t, int count)
+{
+    if (count == 0)
+        return;
+
+    Reserve(indexBuffer, indexCapacity, indexes + size_t(count) * 3, sizeof(int));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, indexes * sizeof(int), size_t(count) * 3 * sizeof(int), t);
+    indexes += size_t(count) * 3;
+}
+
+/*!
+\brief Return the bounding box of the vertexes received so far.
+*/
+Box GLBufferSink::GetBox() const
+{
+    return vertexes == 0 ? Box::Null : Box(lower, upper);
+}
+
 /*!
 \brief Delete all opengl buffers.
 */
@@ -231,6 +411,34 @@ void MeshWidget::MeshGL::Delete()
     glDeleteBuffers(1, &indexBuffer);
 }
 
+/*!
+\brief Upload the AO colors of a MeshColor, which should have the same topology as the one the object was created from.
+*/
+void MeshWidget::MeshGL::UpdateAO(const MeshColor& mesh)
+{
+    if (aoOffset == 0)
+        return;
+
+    const View<int> AOIndexes = mesh.AOIndexView();
+    const View<Color> meshAO = mesh.AOView();
+    int nbVertex = int(AOIndexes.size());
+    assert(nbVertex == triangleCount);
+
+    float* AOColors = new float[nbVertex * 3];
+    for (int i = 0; i < nbVertex; i++)
+    {
+        const Color& AO = meshAO[AOIndexes[i]];
+        AOColors[i * 3 + 0] = float(AO[0]);
+        AOColors[i * 3 + 1] = float(AO[1]);
+        AOColors[i * 3 + 2] = float(AO[2]);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, fullBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, aoOffset, sizeof(float) * nbVertex * 3, AOColors);
+
+    delete[] AOColors;
+}
+
 /*!
 \brief
 */
@@ -422,6 +630,10 @@ void MeshWidget::paintGL()
     }
     profiler.EndGPU();
 
+    // Preview
+    if (!preview.isNull())
+        RenderPreview();
+
     // CPU Profiling
     if (profiler.enabled)
     {
@@ -455,6 +667,28 @@ void MeshWidget::AddMesh(const QString& name, const MeshColor& mesh, const Vecto
     objects.insert(name, new MeshGL(mesh, frame));
 }
 
+/*!
+\brief Add a new single precision mesh in the scene.
+\param mesh new mesh
+\param frame mesh frame, identity by default.
+*/
+void MeshWidget::AddMesh(const QString& name, const MeshFloat& mesh, const Vector& frame)
+{
+    makeCurrent();
+    objects.insert(name, new MeshGL(mesh, frame));
+}
+
+/*!
+\brief Add a new mesh in the scene from the buffers uploaded by a sink, which are handed over to the widget.
+\param sink sink filled while the context of the widget was current.
+\param frame mesh frame, identity by default.
+*/
+void MeshWidget::AddMesh(const QString& name, GLBufferSink& sink, const Vector& frame)
+{
+    makeCurrent();
+    objects.insert(name, new MeshGL(sink, frame));
+}
+
 /*!
 \brief Delete a mesh in the scene from its name.
 \param name mesh name
@@ -481,6 +715,18 @@ void MeshWidget::UpdateMesh(const QString& name, const Vector& frame)
         objects[name]->SetFrame(frame);
 }
 
+/*!
+\brief Re-upload the AO colors of a colored mesh given its name, for instance while they are computed in the background.
+\param name mesh name
+\param mesh colored mesh, with the same topology as the one that was added
+*/
+void MeshWidget::UpdateAO(const QString& name, const MeshColor& mesh)
+{
+    makeCurrent();
+    if (objects.contains(name))
+        objects[name]->UpdateAO(mesh);
+}
+
 /*!
 \brief Enable a mesh given its name.
 \param name mesh name
@@ -599,6 +845,23 @@ void MeshWidget::SetMaterialGlobal(MeshMaterial mat)
         i.value()->material = mat;
 }
 
+/*!
+\brief Draw the preview image over the whole widget.
+*/
+void MeshWidget::RenderPreview()
+{
+    // Unbind VAO and program as in RenderStats()
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    QPainter painter;
+    painter.begin(this);
+    painter.drawImage(rect(), preview);
+    painter.end();
+}
+
 /*!
 \brief Changes the wireframe render flag for a mesh given its name.
 \param name mesh name
@@ -640,6 +903,28 @@ void MeshWidget::SetShadingGlobal(MeshShading shading)
         i.value()->shading = shading;
 }
 
+/*!
+\brief Render an implicit surface on the CPU from the current camera, and draw the image over the scene.
+
+The image is not updated when the camera moves, the function should be called again.
+\param tracer sphere tracer of the surface.
+*/
+void MeshWidget::SetPreview(const SphereTracer& tracer)
+{
+    preview = QImage(width(), height(), QImage::Format_ARGB32);
+    tracer.Render(camera, width(), height(), reinterpret_cast<unsigned int*>(preview.bits()));
+    update();
+}
+
+/*!
+\brief Remove the preview image.
+*/
+void MeshWidget::ClearPreview()
+{
+    preview = QImage();
+    update();
+}
+
 
 /*!
 \brief Capture the rendering viewport and save it to disk.
@@ -1,5 +1,8 @@
 #include "mesh.h"
 
+#include <cmath>
+#include <unordered_map>
+
 /*!
 \class Mesh mesh.h
 
@@ -63,27 +66,52 @@ Mesh::~Mesh() = default;
 /*!
 \brief Smooth the normals of the mesh.
 
-This function weights the normals of the faces by their corresponding area.
-\sa Triangle::AreaNormal()
-*/
-void Mesh::SmoothNormals() {
-    // Initialize
-    normals.resize(vertices.size(), Vector::Null);
+This function weights the normals of the faces by their corresponding area, or by the angle of the faces at the vertex,
+which does not depend on how the faces around the vertex are triangulated.
 
-    narray = varray;
+Normals of faces are computed first, then every vertex gathers the normals of its incident faces from the adjacency,
+so that both passes run in parallel without any race.
 
-    // Accumulate normals
-    for (int i = 0; i < varray.size(); i += 3) {
-        Vector tn = Triangle(vertices[varray.at(i)], vertices[varray.at(i + 1)],
-                             vertices[varray.at(i + 2)]).AreaNormal();
-        normals[narray[i + 0]] += tn;
-        normals[narray[i + 1]] += tn;
-        normals[narray[i + 2]] += tn;
+\param angle Weight normals by angle instead of area.
+\sa Triangle::AreaNormal(), GetAdjacency()
+*/
+void Mesh::SmoothNormals(bool angle) {
+    const Adjacency &adjacency = GetAdjacency();
+    const int nt = Triangles();
+    const int nv = Vertexes();
+
+    // Area normals of the faces
+    std::vector<Vector> face(nt);
+#pragma omp parallel for schedule(static)
+    for (int t = 0; t < nt; t++) {
+        face[t] = Triangle(vertices[varray[3 * t]], vertices[varray[3 * t + 1]], vertices[varray[3 * t + 2]]).AreaNormal();
     }
 
-    // Normalize
-    for (auto &normal: normals) {
-        Normalize(normal);
+    normals.resize(nv);
+    narray = varray;
+
+    // Gather normals, faces are visited in increasing order as in a serial accumulation
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (int v = 0; v < nv; v++) {
+        Vector n = Vector::Null;
+        for (int k = 0; k < adjacency.Faces(v); k++) {
+            const int t = adjacency.Face(v, k);
+            if (!angle) {
+                n += face[t];
+                continue;
+            }
+            const double area = Norm(face[t]);
+            if (area == 0.0) {
+                continue;
+            }
+            const int i = varray[3 * t] == v ? 0 : (varray[3 * t + 1] == v ? 1 : 2);
+            const Vector e1 = vertices[varray[3 * t + (i + 1) % 3]] - vertices[v];
+            const Vector e2 = vertices[varray[3 * t + (i + 2) % 3]] - vertices[v];
+            const double c = Math::Clamp((e1 * e2) / (Norm(e1) * Norm(e2)), -1.0, 1.0);
+            n += face[t] * (std::acos(c) / area);
+        }
+        Normalize(n);
+        normals[v] = n;
     }
 }
 
@@ -93,6 +121,7 @@ void Mesh::SmoothNormals() {
 \param na, nb, nc Index of the normals.
 */
 void Mesh::AddSmoothTriangle(int a, int na, int b, int nb, int c, int nc) {
+    InvalidateTopology();
     varray.push_back(a);
     narray.push_back(na);
     varray.push_back(b);
@@ -107,6 +136,7 @@ void Mesh::AddSmoothTriangle(int a, int na, int b, int nb, int c, int nc) {
 \param n Index of the normal.
 */
 void Mesh::AddTriangle(int a, int b, int c, int n) {
+    InvalidateTopology();
     varray.push_back(a);
     narray.push_back(n);
     varray.push_back(b);
@@ -140,6 +170,25 @@ void Mesh::AddQuadrangle(int a, int b, int c, int d) {
     AddSmoothQuadrangle(a, a, b, b, c, c, d, d);
 }
 
+/*!
+\brief Fill the cache of flat triangles of the mesh.
+*/
+void Mesh::BuildFlat() const {
+    const int n = Triangles();
+    flat.resize(n);
+    for (int i = 0; i < n; i++) {
+        const Vector &a = vertices[varray[i * 3 + 0]];
+        const Vector e1 = vertices[varray[i * 3 + 1]] - a;
+        const Vector e2 = vertices[varray[i * 3 + 2]] - a;
+        FlatTriangle &triangle = flat[i];
+        for (int k = 0; k < 3; k++) {
+            triangle.v0[k] = a[k];
+            triangle.e1[k] = e1[k];
+            triangle.e2[k] = e2[k];
+        }
+    }
+}
+
 /*!
 \brief Compute the bounding box of the object.
 */
@@ -150,6 +199,149 @@ Box Mesh::GetBox() const {
     return Box(vertices);
 }
 
+/*!
+\brief Compute a 64-bit FNV-1a hash of the geometry.
+
+The hash covers the vertices, normals and both index arrays, so that two meshes with the
+same hash may be considered identical, for instance to cache data computed on the mesh.
+*/
+std::uint64_t Mesh::Hash() const {
+    std::uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](const void *data, size_t size) {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+    const size_t sizes[4] = {vertices.size(), normals.size(), varray.size(), narray.size()};
+    add(sizes, sizeof(sizes));
+    for (const Vector &v: vertices) {
+        const double c[3] = {v[0], v[1], v[2]};
+        add(c, sizeof(c));
+    }
+    for (const Vector &n: normals) {
+        const double c[3] = {n[0], n[1], n[2]};
+        add(c, sizeof(c));
+    }
+    add(varray.data(), varray.size() * sizeof(int));
+    add(narray.data(), narray.size() * sizeof(int));
+    return hash;
+}
+
+/*!
+\brief Merge the vertexes closer than a tolerance, and the normals closer than another one.
+
+Vertex and normal indexes are remapped, arrays are compacted and triangles that become degenerate are removed.
+The primitive constructors, Merge() and the polygonizers produce many coincident vertexes, which this function
+removes in linear time with a spatial hash grid.
+
+\param epsilon Tolerance for vertexes, nothing is welded if it is not strictly positive.
+\param delta Tolerance for normals, normals are kept if it is not strictly positive.
+\return The number of vertexes removed.
+*/
+int Mesh::Weld(double epsilon, double delta) {
+    if (!(epsilon > 0.0)) {
+        return 0;
+    }
+    InvalidateTopology();
+
+    std::vector<int> vremap;
+    std::vector<int> nremap;
+    const int before = Vertexes();
+    const bool weldNormals = delta > 0.0;
+    vertices = Cluster(vertices, epsilon, vremap);
+    if (weldNormals) {
+        normals = Cluster(normals, delta, nremap);
+    }
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < int(varray.size()); i++) {
+        varray[i] = vremap[varray[i]];
+        if (weldNormals) {
+            narray[i] = nremap[narray[i]];
+        }
+    }
+
+    // Remove degenerate triangles
+    int k = 0;
+    for (int i = 0; i < int(varray.size()); i += 3) {
+        if (varray[i] != varray[i + 1] && varray[i + 1] != varray[i + 2] && varray[i + 2] != varray[i]) {
+            for (int j = 0; j < 3; j++) {
+                varray[k + j] = varray[i + j];
+                narray[k + j] = narray[i + j];
+            }
+            k += 3;
+        }
+    }
+    varray.resize(k);
+    narray.resize(k);
+
+    return before - Vertexes();
+}
+
+/*!
+\brief Cluster points closer than a tolerance with a spatial hash grid.
+
+Points are visited in order, and every point is merged with the first representative closer than the tolerance
+found in the 27 cells around it, or becomes a new representative. Cells of the grid have the size of the tolerance
+and are hashed, collisions only lengthen the lists of representatives which are checked by distance.
+Cell keys are computed in parallel.
+
+\param p Points.
+\param epsilon Tolerance, strictly positive.
+\param remap Returned index of the representative of every point.
+\return The representatives.
+*/
+std::vector<Vector> Mesh::Cluster(const std::vector<Vector> &p, double epsilon, std::vector<int> &remap) {
+    const int n = int(p.size());
+    auto hash = [](std::int64_t x, std::int64_t y, std::int64_t z) {
+        return std::uint64_t(x) * 73856093ull ^ std::uint64_t(y) * 19349663ull ^ std::uint64_t(z) * 83492791ull;
+    };
+
+    std::vector<std::int64_t> cell(3 * size_t(n));
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < 3; k++) {
+            cell[3 * i + k] = std::int64_t(std::floor(p[i][k] / epsilon));
+        }
+    }
+
+    // Lists of representatives, linked by the index of the next one
+    std::unordered_map<std::uint64_t, int> head;
+    head.reserve(n);
+    std::vector<int> next;
+    std::vector<Vector> q;
+    remap.resize(n);
+
+    const double e2 = epsilon * epsilon;
+    for (int i = 0; i < n; i++) {
+        const std::int64_t *c = &cell[3 * i];
+        int found = -1;
+        for (int x = -1; x <= 1 && found == -1; x++) {
+            for (int y = -1; y <= 1 && found == -1; y++) {
+                for (int z = -1; z <= 1 && found == -1; z++) {
+                    auto it = head.find(hash(c[0] + x, c[1] + y, c[2] + z));
+                    for (int r = it == head.end() ? -1 : it->second; r != -1; r = next[r]) {
+                        if (SquaredNorm(q[r] - p[i]) <= e2) {
+                            found = r;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        if (found == -1) {
+            found = int(q.size());
+            q.push_back(p[i]);
+            auto inserted = head.emplace(hash(c[0], c[1], c[2]), found);
+            next.push_back(inserted.second ? -1 : inserted.first->second);
+            inserted.first->second = found;
+        }
+        remap[i] = found;
+    }
+    return q;
+}
+
 /*!
 \brief Creates an axis aligned box.
 
@@ -260,6 +452,8 @@ Mesh::Mesh(const Sphere &sphere, int accuracy) {
 \param s Scaling factor.
 */
 void Mesh::ScaleUniform(double s) {
+    Invalidate();
+
     // Vertexes
     for (auto &vertice: vertices) {
         vertice *= s;
@@ -285,6 +479,7 @@ void Mesh::ScaleUniform(double s) {
 \param filename File name.
 */
 void Mesh::Load(const QString &filename) {
+    InvalidateTopology();
     vertices.clear();
     normals.clear();
     varray.clear();
@@ -358,6 +553,8 @@ void Mesh::SaveObj(const QString &url, const QString &meshName) const {
  * @param Up rotate around
  */
 void Mesh::Rotate(double Angle, const Vector &Up) {
+    Invalidate();
+
     Matrix rot = Matrix::rotate(Angle, Up);
     // Vertexes
     for (auto &vertice: vertices) {
@@ -379,6 +576,8 @@ void Mesh::Rotate(double Angle, const Vector &Up) {
  * @param z
  */
 void Mesh::Scale(double x, double y, double z) {
+    Invalidate();
+
     Matrix rot = Matrix::scale(x, y, z);
     // Vertexes
     for (auto &vertice: vertices) {
@@ -410,6 +609,8 @@ void Mesh::Scale(double x, double y, double z) {
  * @param t translation value
  */
 void Mesh::Translate(const Vector &t) {
+    Invalidate();
+
     // Vertexes
     for (auto &vertice: vertices) {
         vertice += t;
@@ -421,6 +622,8 @@ void Mesh::Translate(const Vector &t) {
  * @param m to merge
  */
 void Mesh::Merge(const Mesh &m) {
+    InvalidateTopology();
+
     int preMergeCountVertex = Mesh::vertices.size();
     int preMergeCountNormal = Mesh::normals.size();
     for (auto &vert: m.vertices) {
@@ -447,6 +650,8 @@ void Mesh::Merge(const Mesh &m) {
  * @return 0 to 1 value of the warp at each vertice
  */
 std::vector<double> Mesh::SphereWarp(const Sphere &s, const Vector &dir) {
+    Invalidate();
+
     std::vector<double> buff;
     for (auto &vert: Mesh::vertices) {
         double ratio = s.OneMinusPercentToCenter(vert);
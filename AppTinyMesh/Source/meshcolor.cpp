@@ -1,4 +1,8 @@
 #include "meshcolor.h"
+#include "aobaker.h"
+#include "aocache.h"
+#include "bvh.h"
+#include "disktree.h"
 
 /*!
 \brief Create an empty mesh.
@@ -6,6 +10,20 @@
 MeshColor::MeshColor() {
 }
 
+/*!
+\brief Constructor from a Mesh with color array and indices, without ambient occlusion.
+
+The ambient occlusion is white, it may be computed later with Accessibility() or in the background with AOBaker.
+\param m Base mesh.
+\param cols Color array.
+\param carr Color indexes, should be the same size as Mesh::varray and Mesh::narray.
+*/
+MeshColor::MeshColor(const Mesh &m, const std::vector<Color> &cols, const std::vector<int> &carr)
+        : Mesh(m), colors(cols), carray(carr) {
+    aocolors.assign(vertices.size(), Color(1.0, 1.0, 1.0));
+    aoarray = carray;
+}
+
 /*!
 \brief Constructor from a Mesh with color array and indices.
 \param m Base mesh.
@@ -57,61 +75,114 @@ void MeshColor::DebugVertices() {
 
 /**
  * Compute the AO of the mesh
- * @param accuracy Number of ray used, if > 1 then the number of ray is : ((accuracy*4)(accuracy^2))
+ *
+ * Vertices are processed in parallel when OpenMP is enabled. Every vertex only depends on the
+ * mesh and writes its own slot of the AO array, so the result does not depend on the number of threads.
+ *
+ * Ray directions come from a precomputed hemisphere sampling set, mapped to the frame of every vertex.
+ * @param accuracy Number of ray used, if > 1 then the number of ray is : 1+((accuracy*4-1)(accuracy^2))
  * @param range
+ * @param sampling Distribution of the ray directions, uniform by default, stratified and low-discrepancy sets converge faster
  */
-void MeshColor::Accessibility(int accuracy, double range) {
-    aocolors.reserve(carray.size());
-    double deltaTheta = (0.5 * Math::PI()) / ((double) (accuracy * 4));
-    double deltaPhi = (2.0 * Math::PI()) / ((double) accuracy * accuracy);
-    static double bias = 1.0e-1;
-
-
-    for (int vertIndex = 0; vertIndex < Vertexes(); vertIndex++) {
-        double theta = 0;
-        double phi = 0;
-        double buffer = 0;
-        double count = 0;
-        double rotateZ = std::acos(Normal(vertIndex) * Vector::Z);
-        double rotateX = std::acos(Normal(vertIndex) * Vector::X);
-        double rotateY = std::acos(Normal(vertIndex) * Vector::Y);
-        Matrix rot = Matrix::rotate(-rotateZ, Normal(vertIndex) / Vector::Z);
-        Matrix rotZ = (rotateY < Math::DegreeToRadian(90)) ?
-                      Matrix::rotate(rotateX, Vector::Z) :
-                      Matrix::rotate(-rotateX, Vector::Z);
-
-        for (int row = 0; row < (accuracy == 1 ? 1 : accuracy * 4); ++row) {
-            phi = 0;
-            for (int point = 0; point < (row == 0 ? 1 : accuracy * accuracy); ++point) {
-                double x = std::sin(theta) * std::cos(phi);
-                double y = std::sin(theta) * std::sin(phi);
-                double z = std::cos(theta);
-                Vector dir(x, y, z);
-                dir = Normalized(rot * (rotZ * dir));
-                Ray ray(Vertex(vertIndex) + (Normal(vertIndex) * bias), dir);
-                count++;
-                for (int i = 0; i < Triangles(); ++i) {
-                    Ray::RayHitTriangle hit;
-                    if (GetTriangle(i).Intersect(ray, hit.depth, hit.u, hit.v)) {
-                        if (hit.depth > 0 && hit.depth <= range) {
-                            buffer += 1;
-                            break;
-                        }
-                    }
-                }
-                phi += deltaPhi;
-            }
-            theta += deltaTheta;
-        }
+void MeshColor::Accessibility(int accuracy, double range, HemisphereSampling sampling) {
+    // Rays are traced against a hierarchy instead of every triangle
+    const BVH bvh(*this);
+    Accessibility(bvh, accuracy, range, sampling);
+}
 
-        assert(((double) buffer / (double) count) <= 1.0);
-        double res = Math::Clamp(1.0 - (buffer / count));
-        aocolors.emplace_back(res, res, res);
+/**
+ * Compute the AO of the mesh, with rays traced against a given occluder
+ *
+ * The occluder may be a Scene of analytic primitives the mesh was tessellated from,
+ * which is both exact and much cheaper to trace than the triangles of the mesh.
+ * @param occluder Geometry casting the occlusion
+ * @param accuracy Accuracy, see Accessibility(int, double, HemisphereSampling)
+ * @param range
+ * @param sampling Distribution of the ray directions
+ */
+void MeshColor::Accessibility(const Intersectable &occluder, int accuracy, double range, HemisphereSampling sampling) {
+    const int n = Vertexes();
+    aocolors.assign(n, Color(1.0, 1.0, 1.0));
+
+    const int rays = Rays(accuracy);
+    const HemisphereSampler sampler(rays, sampling);
+
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int vertIndex = 0; vertIndex < n; vertIndex++) {
+        int buffer = AOBaker::Occlusion(occluder, Vertex(vertIndex), Normalized(Normal(vertIndex)), sampler, range);
+
+        double res = Math::Clamp(1.0 - ((double) buffer / (double) rays));
+        aocolors[vertIndex] = Color(res, res, res);
     }
 
+    aoarray = carray;
+}
+
+
 
-    for (auto elem: carray) {
-        aoarray.push_back(elem);
+/**
+ * Compute an approximation of the AO of the mesh, fast enough for interactive previews
+ *
+ * Every vertex is an oriented disk occluding the other ones, and distant clusters of disks are merged,
+ * so the cost is close to linear in the number of vertices. Every extra pass scales the occlusion of the
+ * disks by their accessibility from the previous one, which lightens areas where occluders overlap.
+ * Accessibility remains the reference, for final quality.
+ * @param range
+ * @param passes Number of passes
+ * @param threshold Distance, relative to their radius, beyond which clusters of disks are merged, see DiskTree
+ */
+void MeshColor::ApproximateAccessibility(double range, int passes, double threshold) {
+    const int n = Vertexes();
+    DiskTree tree(*this);
+
+    std::vector<double> accessibility(n, 1.0);
+    for (int pass = 0; pass < passes; pass++) {
+        if (pass > 0) {
+            tree.SetAccessibility(accessibility);
+        }
+        std::vector<double> next(n);
+#pragma omp parallel for schedule(dynamic, 64)
+        for (int i = 0; i < n; i++) {
+            next[i] = Math::Clamp(1.0 - tree.Occlusion(i, range, threshold));
+        }
+        accessibility.swap(next);
+    }
+
+    aocolors.resize(n);
+    for (int i = 0; i < n; i++) {
+        aocolors[i] = Color(accessibility[i], accessibility[i], accessibility[i]);
+    }
+    aoarray = carray;
+}
+
+/**
+ * Compute the AO of the mesh, or load it from a cache
+ *
+ * The cache is consulted before computing anything, and the AO is saved to the cache when it had to be computed.
+ * @param cache AO cache
+ * @param accuracy Accuracy, see Accessibility(int, double, HemisphereSampling)
+ * @param range
+ * @param sampling Distribution of the ray directions
+ * @return True if the AO was found in the cache
+ */
+bool MeshColor::Accessibility(const AOCache &cache, int accuracy, double range, HemisphereSampling sampling) {
+    const std::uint64_t key = AOCache::Key(*this, Rays(accuracy), range, sampling);
+    if (cache.Load(key, Vertexes(), aocolors)) {
+        aoarray = carray;
+        return true;
     }
+    Accessibility(accuracy, range, sampling);
+    cache.Save(key, aocolors);
+    return false;
+}
+
+/**
+ * Replace the AO of the mesh, for instance with a buffer computed by AOBaker
+ *
+ * @param ao AO colors, one per vertex
+ */
+void MeshColor::SetAO(const std::vector<Color> &ao) {
+    aocolors = ao;
+    aoarray = carray;
 }
 
@@ -0,0 +1,76 @@
+// Single precision mesh
+
+#include "meshfloat.h"
+
+#include <unordered_map>
+
+/*!
+\class MeshFloat meshfloat.h
+\brief Compact triangle mesh in single precision, for rendering and storage.
+
+Vertexes and normals are stored as tightly packed floats, and a single index array is shared by both,
+which is the layout of OpenGL vertex buffers: the mesh is uploaded without any conversion, and takes less
+than half the memory of a Mesh. Accessors return double precision vectors, and the mesh may be converted
+back and forth from a Mesh.
+*/
+
+/*!
+\brief Create a single precision mesh.
+
+Every distinct pair of vertex and normal indexes of the corners of the triangles yields a vertex, so vertexes
+are only duplicated when they have several normals, as on sharp edges. Unreferenced vertexes are removed.
+
+\param mesh The mesh.
+*/
+MeshFloat::MeshFloat(const Mesh &mesh) {
+    const View<int> va = mesh.VertexIndexView();
+    const View<int> na = mesh.NormalIndexView();
+
+    indexes.resize(va.size());
+    std::unordered_map<long long, int> pairs;
+    pairs.reserve(mesh.Vertexes());
+    vertices.reserve(3 * size_t(mesh.Vertexes()));
+    normals.reserve(3 * size_t(mesh.Vertexes()));
+    for (size_t i = 0; i < va.size(); i++) {
+        const long long key = (long long) (va[i]) << 32 | (unsigned int) (na[i]);
+        auto inserted = pairs.emplace(key, Vertexes());
+        if (inserted.second) {
+            const Vector &p = mesh.VertexData()[va[i]];
+            const Vector &n = mesh.NormalData()[na[i]];
+            for (int k = 0; k < 3; k++) {
+                vertices.push_back(float(p[k]));
+                normals.push_back(float(n[k]));
+            }
+        }
+        indexes[i] = inserted.first->second;
+    }
+}
+
+/*!
+\brief Convert to a double precision mesh, with the same vertex and normal indexes.
+*/
+Mesh MeshFloat::ToMesh() const {
+    std::vector<Vector> v(Vertexes());
+    std::vector<Vector> n(Vertexes());
+    for (int i = 0; i < Vertexes(); i++) {
+        v[i] = Vertex(i);
+        n[i] = Normal(i);
+    }
+    return Mesh(std::move(v), std::move(n), indexes, indexes);
+}
+
+/*!
+\brief Compute the bounding box of the vertexes.
+*/
+Box MeshFloat::GetBox() const {
+    if (vertices.empty()) {
+        return Box::Null;
+    }
+    Vector a = Vertex(0);
+    Vector b = a;
+    for (int i = 1; i < Vertexes(); i++) {
+        a = Vector::Min(a, Vertex(i));
+        b = Vector::Max(b, Vertex(i));
+    }
+    return Box(a, b);
+}
@@ -3,7 +3,11 @@
 #include "../UI/ui_interface.h"
 #include "timer.h"
 
-MainWindow::MainWindow() : QMainWindow(), uiw(new Ui::Assets) {
+#include <QtWidgets/qstatusbar.h>
+#include <QtCore/qstandardpaths.h>
+
+MainWindow::MainWindow() : QMainWindow(), uiw(new Ui::Assets),
+    aoCache((QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/AOCache").toStdString()) {
     // Chargement de l'interface
     uiw->setupUi(this);
 
@@ -14,6 +18,10 @@ MainWindow::MainWindow() : QMainWindow(), uiw(new Ui::Assets) {
     GLlayout->setContentsMargins(0, 0, 0, 0);
     uiw->widget_GL->setLayout(GLlayout);
 
+    // Ambient occlusion is computed in the background and polled by a timer
+    aoTimer = new QTimer(this);
+    aoTimer->setInterval(50);
+
     // Creation des connect
     CreateActions();
 
@@ -37,6 +45,7 @@ void MainWindow::CreateActions() {
     connect(uiw->radioShadingButton_1, SIGNAL(clicked()), this, SLOT(UpdateMaterial()));
     connect(uiw->radioShadingButton_2, SIGNAL(clicked()), this, SLOT(UpdateMaterial()));
     connect(uiw->radioShadingButton_3, SIGNAL(clicked()), this, SLOT(UpdateMaterial()));
+    connect(aoTimer, SIGNAL(timeout()), this, SLOT(UpdateAO()));
 
     // Widget edition
     connect(meshWidget, SIGNAL(_signalEditSceneLeft(
@@ -65,7 +74,7 @@ void MainWindow::BoxMeshExample() {
         cols[i] = Color(0.8,0.8,0.8);
     }
 
-    meshColor = MeshColor(boxMesh, cols, boxMesh.VertexIndexes(), uiw->lineAOAcc->text().toUInt(), uiw->lineAORange->text().toDouble());
+    meshColor = MeshColor(boxMesh, cols, boxMesh.VertexIndexes());
     UpdateGeometry();
     timer.Stop();
     uiw->lineRenTime->setText(QString::number(timer.ElapsedMilliSeconds(), 'G'));
@@ -118,7 +127,7 @@ void MainWindow::DemoExample() {
     for (auto &col: cols) {
         col = Color(0.8, 0.8, 0.8);
     }
-    meshColor = MeshColor(base, cols, base.VertexIndexes(), uiw->lineAOAcc->text().toUInt(), uiw->lineAORange->text().toDouble());
+    meshColor = MeshColor(base, cols, base.VertexIndexes());
     UpdateGeometry();
     uiw->lineRenTime->setText(QString::number(timer.ElapsedMilliSeconds(), 'G'));
 }
@@ -136,6 +145,41 @@ void MainWindow::UpdateGeometry() {
     uiw->lineEdit_2->setText(QString::number(meshColor.Triangles()));
 
     UpdateMaterial();
+
+    // Use the cached ambient occlusion if this mesh was already baked with the same parameters
+    aoRays = MeshColor::Rays(uiw->lineAOAcc->text().toUInt());
+    const double range = uiw->lineAORange->text().toDouble();
+    aoKey = AOCache::Key(meshColor, aoRays, range, HemisphereSampling::LowDiscrepancy);
+    std::vector<Color> ao;
+    if (aoCache.Load(aoKey, meshColor.Vertexes(), ao)) {
+        aoBaker.Cancel();
+        aoTimer->stop();
+        meshColor.SetAO(ao);
+        meshWidget->UpdateAO("BoxMesh", meshColor);
+        statusBar()->showMessage(QString("Ambient occlusion: %1 rays, cached").arg(aoRays));
+        return;
+    }
+
+    // Refine the ambient occlusion progressively, cancelling the one of the previous mesh
+    aoBaker.Start(meshColor, AOBaker::Passes(aoRays), range, HemisphereSampling::LowDiscrepancy);
+    aoTimer->start();
+}
+
+void MainWindow::UpdateAO() {
+    // Check whether the worker is done before polling, so that its last buffer is not missed
+    const bool running = aoBaker.Running();
+    std::vector<Color> ao;
+    int rays;
+    if (aoBaker.Poll(ao, rays)) {
+        meshColor.SetAO(ao);
+        meshWidget->UpdateAO("BoxMesh", meshColor);
+        statusBar()->showMessage(QString("Ambient occlusion: %1 rays").arg(rays));
+        if (rays == aoRays) {
+            aoCache.Save(aoKey, ao);
+        }
+    } else if (!running) {
+        aoTimer->stop();
+    }
 }
 
 void MainWindow::UpdateMaterial() {
@@ -166,7 +210,7 @@ void MainWindow::SphereMeshExample() {
     for (auto &col: cols) {
         col = Color(0.8, 0.8, 0.8);
     }
-    meshColor = MeshColor(mesh, cols, mesh.VertexIndexes(), uiw->lineAOAcc->text().toUInt(), uiw->lineAORange->text().toDouble());
+    meshColor = MeshColor(mesh, cols, mesh.VertexIndexes());
     UpdateGeometry();
     timer.Stop();
     uiw->lineRenTime->setText(QString::number(timer.ElapsedMilliSeconds(), 'G'));
@@ -189,7 +233,7 @@ void MainWindow::CylinderMeshExample() {
     for (auto &col: cols) {
         col = Color(0.8, 0.8, 0.8);
     }
-    meshColor = MeshColor(mesh, cols, mesh.VertexIndexes(), uiw->lineAOAcc->text().toUInt(), uiw->lineAORange->text().toDouble());
+    meshColor = MeshColor(mesh, cols, mesh.VertexIndexes());
     UpdateGeometry();
     timer.Stop();
     uiw->lineRenTime->setText(QString::number(timer.ElapsedMilliSeconds(), 'G'));
@@ -213,7 +257,7 @@ void MainWindow::CapsuleMeshExample() {
     for (auto &col: cols) {
         col = Color(0.8, 0.8, 0.8);
     }
-    meshColor = MeshColor(mesh, cols, mesh.VertexIndexes(), uiw->lineAOAcc->text().toUInt(), uiw->lineAORange->text().toDouble());
+    meshColor = MeshColor(mesh, cols, mesh.VertexIndexes());
     UpdateGeometry();
     timer.Stop();
     uiw->lineRenTime->setText(QString::number(timer.ElapsedMilliSeconds(), 'G'));
@@ -242,7 +286,7 @@ void MainWindow::TorusMeshExample() {
         }
         count++;
     }
-    meshColor = MeshColor(mesh, cols, mesh.VertexIndexes(), uiw->lineAOAcc->text().toUInt(), uiw->lineAORange->text().toDouble());
+    meshColor = MeshColor(mesh, cols, mesh.VertexIndexes());
     UpdateGeometry();
     timer.Stop();
     uiw->lineRenTime->setText(QString::number(timer.ElapsedMilliSeconds(), 'G'));
@@ -0,0 +1,105 @@
+// Hemisphere sampling
+
+#include "sampling.h"
+
+#include <random>
+#include <utility>
+
+/*!
+\class HemisphereSampler sampling.h
+\brief Precomputed set of unit directions over the hemisphere around the z axis.
+
+The directions are computed once, and mapped to the frame of a surface point with
+a few multiplications, which avoids any trigonometric function when casting rays.
+
+Random sets are generated with a fixed seed so that results are reproducible.
+With cosine-weighted sets, the ratio of occluded rays directly estimates the
+cosine-weighted ambient occlusion.
+*/
+
+/*!
+\brief Create a set of directions.
+\param n Number of directions.
+\param sampling Distribution.
+\param seed Seed of the random generator for random sets, index of the first sample for the low discrepancy set.
+*/
+HemisphereSampler::HemisphereSampler(int n, HemisphereSampling sampling, int seed) {
+    directions.reserve(n);
+
+    std::mt19937 generator(seed);
+    auto random = [&generator]() { return generator() / 4294967296.0; };
+
+    switch (sampling) {
+        case HemisphereSampling::Uniform:
+            for (int i = 0; i < n; i++) {
+                double u = random();
+                directions.push_back(Uniform(u, random()));
+            }
+            break;
+        case HemisphereSampling::Cosine:
+            for (int i = 0; i < n; i++) {
+                double u = random();
+                directions.push_back(Cosine(u, random()));
+            }
+            break;
+        case HemisphereSampling::Stratified: {
+            // N-rooks: one sample per stratum along both parameters, for any number of samples
+            std::vector<int> permutation(n);
+            for (int i = 0; i < n; i++) {
+                permutation[i] = i;
+            }
+            for (int i = n - 1; i > 0; i--) {
+                std::swap(permutation[i], permutation[generator() % (i + 1)]);
+            }
+            for (int i = 0; i < n; i++) {
+                double u = (i + random()) / n;
+                double v = (permutation[i] + random()) / n;
+                directions.push_back(Cosine(u, v));
+            }
+            break;
+        }
+        case HemisphereSampling::LowDiscrepancy:
+            for (int i = seed; i < seed + n; i++) {
+                directions.push_back(Cosine(Halton(i, 2), Halton(i, 3)));
+            }
+            break;
+    }
+}
+
+/*!
+\brief Compute the radical inverse of an integer, which defines the Halton sequence.
+\param i Index.
+\param base Prime base.
+*/
+double HemisphereSampler::Halton(int i, int base) {
+    double f = 1.0;
+    double r = 0.0;
+    while (i > 0) {
+        f /= base;
+        r += f * (i % base);
+        i /= base;
+    }
+    return r;
+}
+
+/*!
+\brief Map the unit square to the hemisphere with a cosine-weighted density.
+
+Points are uniformly distributed over the unit disk and projected onto the hemisphere.
+\param u, v Coordinates in the unit square.
+*/
+Vector HemisphereSampler::Cosine(double u, double v) {
+    double r = sqrt(u);
+    double phi = 2.0 * Math::PI() * v;
+    return Vector(r * cos(phi), r * sin(phi), sqrt(Math::Max(0.0, 1.0 - u)));
+}
+
+/*!
+\brief Map the unit square to the hemisphere with a uniform density.
+\param u, v Coordinates in the unit square.
+*/
+Vector HemisphereSampler::Uniform(double u, double v) {
+    double r = sqrt(Math::Max(0.0, 1.0 - u * u));
+    double phi = 2.0 * Math::PI() * v;
+    return Vector(r * cos(phi), r * sin(phi), u);
+}
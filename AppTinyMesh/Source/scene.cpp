@@ -0,0 +1,281 @@
+// Scene of analytic primitives
+
+#include "scene.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+const int Scene::leaf = 2;
+
+/*!
+\class Scene scene.h
+\brief Set of transformed analytic primitives for ray queries.
+
+Primitives are intersected exactly in their own frame, instead of intersecting the
+thousands of triangles of their tessellation. Every instance has a rotation, a possibly
+non uniform scale and a translation. Instances are organized in a top-level bounding
+volume hierarchy, which should be rebuilt with Build() after adding instances.
+
+\code
+Scene scene;
+scene.Add(std::make_shared<Sphere>(Vector::Null, 1.0), Vector(0.0, 0.0, 5.0));
+scene.Add(std::make_shared<Torus>(Vector::Null, 4.0, 10.0), Vector(0.0, 0.0, 5.0), Matrix::rotateAroundY(0.4), Vector(1.0, 1.0, 0.05));
+scene.Build();
+double t, t1, t2;
+if (scene.Intersect(ray, t, t1, t2))
+{
+  Vector p = ray(t);
+}
+\endcode
+
+Primitives are shared, so the same primitive may be instanced several times.
+*/
+
+/*!
+\brief Add an instance of a primitive.
+
+The primitive is first scaled along its axes, then rotated and finally translated.
+
+\param primitive The primitive.
+\param translation Translation.
+\param rotation Rotation matrix.
+\param scale Scale factors along the axes of the primitive, which should be strictly positive.
+\return The index of the instance.
+*/
+int Scene::Add(const std::shared_ptr<const Primitive> &primitive, const Vector &translation, const Matrix &rotation,
+               const Vector &scale) {
+    Matrix forward = rotation;
+    Matrix inverse = Transpose(rotation);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            forward[i * 3 + j] *= scale[j];
+            inverse[i * 3 + j] /= scale[i];
+        }
+    }
+
+    // Bounding box of the transformed vertices of the box of the primitive
+    const Box local = primitive->GetBox();
+    std::vector<Vector> corners(8);
+    for (int k = 0; k < 8; k++) {
+        corners[k] = forward * local.Vertex(k) + translation;
+    }
+
+    instances.push_back({primitive, forward, inverse, translation, Box(corners)});
+    nodes.clear();
+    return int(instances.size()) - 1;
+}
+
+/*!
+\brief Build the top-level hierarchy over the instances.
+*/
+void Scene::Build() {
+    nodes.clear();
+    indexes.resize(instances.size());
+    for (int i = 0; i < int(instances.size()); i++) {
+        indexes[i] = i;
+    }
+    if (!instances.empty()) {
+        Build(0, int(instances.size()));
+    }
+}
+
+/*!
+\brief Recursively build the node enclosing a range of instances, split at the median of their centers.
+\param first, last Range of Scene::indexes.
+\return The index of the node.
+*/
+int Scene::Build(int first, int last) {
+    const int index = int(nodes.size());
+    nodes.push_back(Node());
+
+    Box box = instances[indexes[first]].box;
+    Vector cmin = box.Center();
+    Vector cmax = cmin;
+    for (int i = first + 1; i < last; i++) {
+        box = Box(box, instances[indexes[i]].box);
+        cmin = Vector::Min(cmin, instances[indexes[i]].box.Center());
+        cmax = Vector::Max(cmax, instances[indexes[i]].box.Center());
+    }
+    nodes[index].a = box[0];
+    nodes[index].b = box[1];
+
+    if (last - first <= leaf) {
+        nodes[index].offset = first;
+        nodes[index].count = last - first;
+        return index;
+    }
+
+    const Vector d = cmax - cmin;
+    const int axis = (d[0] > d[1] && d[0] > d[2]) ? 0 : (d[1] > d[2] ? 1 : 2);
+    const int middle = (first + last) / 2;
+    std::nth_element(indexes.begin() + first, indexes.begin() + middle, indexes.begin() + last, [&](int i, int j) {
+        return instances[i].box.Center()[axis] < instances[j].box.Center()[axis];
+    });
+
+    Build(first, middle);
+    int second = Build(middle, last);
+
+    nodes[index].offset = second;
+    nodes[index].count = 0;
+    return index;
+}
+
+/*!
+\brief Compute the bounding box of the scene.
+*/
+Box Scene::GetBox() const {
+    if (instances.empty()) {
+        return Box::Null;
+    }
+    Box box = instances[0].box;
+    for (const Instance &instance: instances) {
+        box = Box(box, instance.box);
+    }
+    return box;
+}
+
+/*!
+\brief Transform a ray into the frame of the primitive of an instance.
+
+The direction of the returned ray is normalized, so depths along it should be divided
+by the returned scale to get depths along the original ray.
+
+\param instance The instance.
+\param ray The ray.
+\param scale Ratio between depths in the frame of the primitive and depths in the scene.
+*/
+inline Ray Scene::Local(const Instance &instance, const Ray &ray, double &scale) {
+    const Vector d = instance.inverse * ray.Direction();
+    scale = Norm(d);
+    return Ray(instance.inverse * (ray.Origin() - instance.translation), d / scale);
+}
+
+/*!
+\brief Check whether a ray intersects the box of a node inside a given interval.
+\param node The node.
+\param o Origin of the ray.
+\param inv Inverse of the direction of the ray.
+\param tmin, tmax Interval.
+*/
+static bool Slab(const Scene::Node &node, const Vector &o, const Vector &inv, double tmin, double tmax) {
+    for (int i = 0; i < 3; i++) {
+        double ta = (node.a[i] - o[i]) * inv[i];
+        double tb = (node.b[i] - o[i]) * inv[i];
+        if (ta > tb) std::swap(ta, tb);
+        tmin = ta > tmin ? ta : tmin;
+        tmax = tb < tmax ? tb : tmax;
+        if (tmin > tmax) return false;
+    }
+    return true;
+}
+
+/*!
+\brief Compute the closest intersection between a ray and the surface of the instances.
+
+Only intersections with a strictly positive depth are reported. When the origin of the ray
+is inside a primitive, the intersection is the exit point.
+
+\param ray The ray (direction should be of unit length).
+\param t Depth of the intersection.
+\param t1, t2 Entry and exit depths of the ray in the intersected instance.
+\param index Index of the intersected instance.
+*/
+bool Scene::Intersect(const Ray &ray, double &t, double &t1, double &t2, int &index) const {
+    assert(nodes.size() > 0 || instances.empty());
+    if (nodes.empty()) {
+        return false;
+    }
+
+    const Vector o = ray.Origin();
+    const Vector inv = ray.Direction().Inverse();
+    double tmax = std::numeric_limits<double>::max();
+    index = -1;
+
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node &node = nodes[stack[--top]];
+        if (!Slab(node, o, inv, 0.0, tmax)) {
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (int k = node.offset; k < node.offset + node.count; k++) {
+                const Instance &instance = instances[indexes[k]];
+                double scale, d, d1, d2;
+                if (!instance.primitive->Intersect(Local(instance, ray, scale), d, d1, d2)) {
+                    continue;
+                }
+                double depth = (d1 > 0.0 ? d1 : d2) / scale;
+                if (depth > 0.0 && depth < tmax) {
+                    tmax = depth;
+                    t1 = d1 / scale;
+                    t2 = d2 / scale;
+                    index = indexes[k];
+                }
+            }
+        } else {
+            stack[top++] = node.offset;
+            stack[top++] = int(&node - nodes.data()) + 1;
+        }
+    }
+
+    if (index == -1) {
+        return false;
+    }
+    t = tmax;
+    return true;
+}
+
+/*!
+\brief Overloaded.
+\param ray The ray (direction should be of unit length).
+\param t Depth of the intersection.
+\param t1, t2 Entry and exit depths of the ray in the intersected instance.
+*/
+bool Scene::Intersect(const Ray &ray, double &t, double &t1, double &t2) const {
+    int index;
+    return Intersect(ray, t, t1, t2, index);
+}
+
+/*!
+\brief Check whether a ray hits the surface of any instance inside a given interval.
+\param ray The ray (direction should be of unit length).
+\param tmin, tmax Interval.
+*/
+bool Scene::Occluded(const Ray &ray, double tmin, double tmax) const {
+    assert(nodes.size() > 0 || instances.empty());
+    if (nodes.empty()) {
+        return false;
+    }
+
+    const Vector o = ray.Origin();
+    const Vector inv = ray.Direction().Inverse();
+
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node &node = nodes[stack[--top]];
+        if (!Slab(node, o, inv, tmin, tmax)) {
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (int k = node.offset; k < node.offset + node.count; k++) {
+                const Instance &instance = instances[indexes[k]];
+                double scale;
+                const Ray local = Local(instance, ray, scale);
+                if (instance.primitive->Occluded(local, tmin * scale, tmax * scale)) {
+                    return true;
+                }
+            }
+        } else {
+            stack[top++] = node.offset;
+            stack[top++] = int(&node - nodes.data()) + 1;
+        }
+    }
+    return false;
+}
@@ -3,6 +3,7 @@
 //
 
 #include "sphere.h"
+#include "box.h"
 
 Sphere::Sphere(const Vector &center, const double &r) : c(center), r(r), r2(r * r) {}
 
@@ -46,6 +47,33 @@ double Sphere::Volume() const {
     return (4.0 / 3.0) * Math::PI() * Sphere::r2 * Sphere::r;
 }
 
+/**
+ * @return bounding box of the sphere
+ */
+Box Sphere::GetBox() const {
+    return Box(c, r);
+}
+
+/**
+ * @param p point
+ * @return signed distance to the sphere, negative inside
+ */
+double Sphere::SignedDistance(const Vector &p) const {
+    return DistanceToSphere(p);
+}
+
+/**
+ * @param p point
+ * @param g returned gradient, the unit direction from the center, any unit vector at the center
+ * @return signed distance to the sphere, negative inside
+ */
+double Sphere::SignedDistanceGradient(const Vector &p, Vector &g) const {
+    const Vector q = p - c;
+    const double d = Norm(q);
+    g = d > 0.0 ? q / d : Vector::Z;
+    return d - r;
+}
+
 void Sphere::Translate(const Vector &v) {
     Sphere::c += v;
 }
@@ -81,3 +109,19 @@ bool Sphere::Intersect(const Ray &ray, double &d, double &d1, double &d2) const
     return true;
 }
 
+/**
+ * Occlusion query, does not compute the signed distance nor reorder the hits
+ * @param ray ray
+ * @param tmin,tmax interval
+ * @return true if the sphere surface is hit inside ]tmin, tmax[
+ */
+bool Sphere::Occluded(const Ray &ray, double tmin, double tmax) const {
+    Vector L = c - ray.Origin();
+    double tca = L * ray.Direction();
+    double ds = (L * L) - (tca * tca);
+    if (ds > r2) return false;
+    double thc = std::sqrt(r2 - ds);
+    double t0 = tca - thc;
+    double t1 = tca + thc;
+    return (t0 > tmin && t0 < tmax) || (t1 > tmin && t1 < tmax);
+}
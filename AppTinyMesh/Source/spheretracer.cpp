@@ -0,0 +1,97 @@
+// Sphere tracing
+
+#include "spheretracer.h"
+
+#include <algorithm>
+
+/*!
+\class SphereTracer spheretracer.h
+\brief Direct rendering of the surface of a scalar field on the CPU, without any polygonization.
+
+Rays march toward the surface by steps equal to the value of the field divided by its Lipschitz constant,
+which never cross the surface, see AnalyticScalarField::Lipschitz(). The image is split into tiles which are
+rendered in parallel when OpenMP is enabled, and hit points are shaded from the normal of the field.
+
+\code
+SphereTracer tracer(tree, tree.GetBox());
+std::vector<unsigned int> image(w * h);
+tracer.Render(camera, w, h, image.data());
+\endcode
+*/
+
+/*!
+\brief Create a renderer.
+\param field The field, which should be kept alive.
+\param box Region of the surface.
+*/
+SphereTracer::SphereTracer(const AnalyticScalarField &field, const Box &box) : field(field), box(box), lipschitz(field.Lipschitz()) {
+}
+
+/*!
+\brief Find the first intersection between a ray and the surface.
+\param ray The ray, whose direction should be unit.
+\param t Returned depth of the intersection.
+*/
+bool SphereTracer::Trace(const Ray &ray, double &t) const {
+    double t1, t2;
+    if (!box.Intersect(ray, t, t1, t2)) {
+        return false;
+    }
+    for (int i = 0; i < steps && t <= t2; i++) {
+        const double v = field.Value(ray(t));
+        if (v < epsilon) {
+            return true;
+        }
+        t += std::max(v / lipschitz, epsilon);
+    }
+    return false;
+}
+
+/*!
+\brief Compute the color seen along a ray, with diffuse shading on the surface and a sky gradient elsewhere.
+\param ray The ray.
+*/
+Color SphereTracer::Shade(const Ray &ray) const {
+    double t;
+    if (!Trace(ray, t)) {
+        return Color::Lerp(0.5 + 0.5 * ray.Direction()[2], Color(0.85, 0.85, 0.85), Color(0.55, 0.65, 0.8));
+    }
+    const Vector n = field.Normal(ray(t));
+    const double diffuse = std::max(n * light, 0.0);
+    return Color(0.8, 0.8, 0.8) * (0.2 + 0.8 * diffuse);
+}
+
+/*!
+\brief Render an image.
+\param camera The camera, rays are computed with Camera::PixelToRay().
+\param w, h Size of the image.
+\param image Returned pixels, row by row from the top, packed as 0xAARRGGBB, see Pack().
+\param tile Size of the square tiles rendered by threads.
+*/
+void SphereTracer::Render(const Camera &camera, int w, int h, unsigned int *image, int tile) const {
+    const int tx = (w + tile - 1) / tile;
+    const int ty = (h + tile - 1) / tile;
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int k = 0; k < tx * ty; k++) {
+        const int x0 = (k % tx) * tile;
+        const int y0 = (k / tx) * tile;
+        for (int y = y0; y < std::min(y0 + tile, h); y++) {
+            for (int x = x0; x < std::min(x0 + tile, w); x++) {
+                image[y * w + x] = Pack(Shade(camera.PixelToRay(x, y, w, h)));
+            }
+        }
+    }
+}
+
+/*!
+\brief Convert a color to a 32 bits pixel, as in QImage::Format_ARGB32.
+\param c Color.
+*/
+unsigned int SphereTracer::Pack(const Color &c) {
+    unsigned int p = 0xFF000000u;
+    for (int i = 0; i < 3; i++) {
+        p |= (unsigned int) (Math::Clamp(c[i]) * 255.0 + 0.5) << (16 - 8 * i);
+    }
+    return p;
+}
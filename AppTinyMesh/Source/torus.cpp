@@ -3,9 +3,43 @@
 //
 
 #include "torus.h"
+#include "box.h"
+
+#include <limits>
+
+const double Torus::epsilon = 1.0e-6;
+const double Torus::grazing = 1.0e-4;
+const int Torus::steps = 1024;
 
 bool Torus::IsInside(const Vector &p) const {
-    return false;//TODO
+    return SignedDistance(p) < 0;
+}
+
+/**
+ * Signed distance to the torus, which lies in the horizontal plane
+ * @param p point
+ * @return negative inside the tube
+ */
+double Torus::SignedDistance(const Vector &p) const {
+    Vector q = p - c;
+    double x = std::sqrt(q[0] * q[0] + q[1] * q[1]) - b;
+    return std::sqrt(x * x + q[2] * q[2]) - a;
+}
+
+/**
+ * Signed distance to the torus and its gradient, the unit direction from the closest point of the central circle
+ * @param p point
+ * @param g returned gradient
+ * @return negative inside the tube
+ */
+double Torus::SignedDistanceGradient(const Vector &p, Vector &g) const {
+    Vector q = p - c;
+    double l = std::sqrt(q[0] * q[0] + q[1] * q[1]);
+    Vector radial = l > 0.0 ? Vector(q[0] / l, q[1] / l, 0.0) : Vector::X;
+    double x = l - b;
+    double d = std::sqrt(x * x + q[2] * q[2]);
+    g = d > 0.0 ? (x * radial + q[2] * Vector::Z) / d : Vector::Z;
+    return d - a;
 }
 
 Vector Torus::Center() const {
@@ -16,6 +50,13 @@ double Torus::Volume() const {
     return (Math::PI()*a*a)*(2*Math::PI()*b);
 }
 
+/**
+ * @return bounding box of the torus, which lies in the horizontal plane
+ */
+Box Torus::GetBox() const {
+    return Box(c - Vector(a + b, a + b, a), c + Vector(a + b, a + b, a));
+}
+
 void Torus::Translate(const Vector &v) {
     Torus::c+=v;
 }
@@ -39,6 +80,79 @@ double Torus::getB() const {
     return b;
 }
 
+/**
+ * Sphere tracing along the ray, the signed distance is 1-Lipschitz so its absolute value is a safe step
+ *
+ * Grazing rays take ever smaller steps along the silhouette and may run out of steps before reaching epsilon,
+ * they hit if they are still within the interval and closer to the surface than grazing times the marched depth.
+ *
+ * @param ray ray
+ * @param t starting depth
+ * @param tmax maximum depth
+ * @param sign 1 to march outside toward the surface, -1 to march inside
+ * @return depth of the surface, or a value greater than tmax if it was not reached
+ */
+double Torus::March(const Ray &ray, double t, double tmax, double sign) const {
+    const double t0 = t;
+    double s = std::numeric_limits<double>::max();
+    for (int i = 0; i < steps && t <= tmax; i++) {
+        s = sign * SignedDistance(ray(t));
+        if (s < epsilon) return t;
+        t += s;
+    }
+    if (t <= tmax && s < grazing * (t - t0)) return t - s;
+    return std::numeric_limits<double>::max();
+}
+
+/**
+ * Intersection with the first span of the ray inside the tube, the torus being non convex
+ * @param ray ray
+ * @param d intersect distance, 0 if ray is inside
+ * @param d1 entry point distance, 0 if ray is inside
+ * @param d2 exit point distance
+ * @return
+ */
 bool Torus::Intersect(const Ray &ray, double &d, double &d1, double &d2) const {
-    return false;
+    // Bounding sphere
+    Vector L = c - ray.Origin();
+    double R = a + b;
+    double tca = L * ray.Direction();
+    double ds = (L * L) - (tca * tca);
+    if (ds > R * R) return false;
+    double thc = std::sqrt(R * R - ds);
+    double t1 = tca + thc;
+    if (t1 < 0) return false;
+
+    if (SignedDistance(ray.Origin()) < 0) {
+        d = d1 = 0;
+    } else {
+        d = d1 = March(ray, Math::Max(tca - thc, 0), t1, 1);
+        if (d1 > t1) return false;
+    }
+    d2 = March(ray, d1 + 2 * epsilon, t1, -1);
+    if (d2 > t1) d2 = t1;
+    return true;
+}
+
+/**
+ * Sphere tracing limited to the interval
+ * @param ray ray
+ * @param tmin,tmax interval
+ * @return true if the torus surface is hit inside ]tmin, tmax[
+ */
+bool Torus::Occluded(const Ray &ray, double tmin, double tmax) const {
+    Vector L = c - ray.Origin();
+    double R = a + b;
+    double tca = L * ray.Direction();
+    double ds = (L * L) - (tca * tca);
+    if (ds > R * R) return false;
+    double thc = std::sqrt(R * R - ds);
+    double t0 = Math::Max(tca - thc, tmin);
+    double t1 = Math::Min(tca + thc, tmax);
+    if (t0 > t1) return false;
+
+    // Inside the tube at the start of the interval, look for the exit instead of the entry
+    double sign = SignedDistance(ray(t0)) < 0 ? -1 : 1;
+    double t = March(ray, t0, t1, sign);
+    return t > tmin && t < tmax;
 }
@@ -96,6 +96,20 @@ bool Triangle::Intersect(const Ray& ray, double& t, double& u, double& v) const
   return true;
 }
 
+/*!
+\brief Check whether a ray hits the triangle inside a given interval.
+
+Same algorithm as Triangle::Intersect(), without returning the intersection.
+
+\param ray The ray (direction should be of unit length).
+\param tmin, tmax Interval.
+*/
+bool Triangle::Occluded(const Ray& ray, double tmin, double tmax) const
+{
+  double t, u, v;
+  return Intersect(ray, t, u, v) && (t > tmin) && (t < tmax);
+}
+
 /*!
 \brief Translates a triangle by a given vector.
 
@@ -0,0 +1,244 @@
+// Triangle packet
+
+#include "trianglepacket.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+const double TrianglePacket::epsilon = 1.0e-7;
+
+/*!
+\class TrianglePacket trianglepacket.h
+\brief A small set of triangles stored by coordinates, tested against a ray in a single call.
+
+Every triangle is stored as its first vertex and its two edge vectors,
+so that the edges are not recomputed for every ray as in Triangle::Intersect().
+
+The intersection kernel uses AVX when the code is compiled with AVX enabled (see the USE_AVX2 option
+in CMakeLists.txt), SSE2 otherwise on x86-64, and falls back to scalar code on other architectures.
+All kernels use the same operations in the same order, and return exactly the same results as Triangle::Intersect().
+
+Unused slots hold degenerate triangles that never intersect.
+*/
+
+/*!
+\brief Create an empty packet.
+*/
+TrianglePacket::TrianglePacket() {
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < Size; j++) {
+            v0[i][j] = e1[i][j] = e2[i][j] = 0.0;
+        }
+    }
+}
+
+/*!
+\brief Create a packet from an array of triangles.
+\param t Array of triangles.
+\param n Number of triangles, should be lower than TrianglePacket::Size.
+*/
+TrianglePacket::TrianglePacket(const Triangle *t, int n) : TrianglePacket() {
+    for (int i = 0; i < n; i++) {
+        Set(i, t[i]);
+    }
+}
+
+/*!
+\brief Set a triangle of the packet.
+\param i Slot.
+\param t The triangle.
+*/
+void TrianglePacket::Set(int i, const Triangle &t) {
+    const Vector a = t[0];
+    const Vector b = t[1] - t[0];
+    const Vector c = t[2] - t[0];
+    for (int k = 0; k < 3; k++) {
+        v0[k][i] = a[k];
+        e1[k][i] = b[k];
+        e2[k][i] = c[k];
+    }
+    if (i >= count) {
+        count = i + 1;
+    }
+}
+
+/*!
+\brief Overloaded, from a flat triangle whose edges are already computed.
+\param i Slot.
+\param t The triangle.
+*/
+void TrianglePacket::Set(int i, const FlatTriangle &t) {
+    for (int k = 0; k < 3; k++) {
+        v0[k][i] = t.v0[k];
+        e1[k][i] = t.e1[k];
+        e2[k][i] = t.e2[k];
+    }
+    if (i >= count) {
+        count = i + 1;
+    }
+}
+
+/*!
+\brief Compute the intersection between a ray and all the triangles of the packet.
+
+This is the same Moller-Trumbore algorithm as Triangle::Intersect(), evaluated for all triangles at once.
+
+\param ray The ray (direction should be of unit length).
+\param tmin, tmax Only intersections with a depth in ]tmin, tmax[ are reported.
+\param t Intersection depths, array of TrianglePacket::Size elements.
+\param u,v Parametric coordinates of the intersections, arrays of TrianglePacket::Size elements.
+\return Bit mask of the intersected triangles.
+*/
+int TrianglePacket::Intersect(const Ray &ray, double tmin, double tmax, double *t, double *u, double *v) const {
+    const Vector o = ray.Origin();
+    const Vector d = ray.Direction();
+
+#if defined(__AVX__)
+    const __m256d dx = _mm256_set1_pd(d[0]), dy = _mm256_set1_pd(d[1]), dz = _mm256_set1_pd(d[2]);
+    const __m256d e1x = _mm256_load_pd(e1[0]), e1y = _mm256_load_pd(e1[1]), e1z = _mm256_load_pd(e1[2]);
+    const __m256d e2x = _mm256_load_pd(e2[0]), e2y = _mm256_load_pd(e2[1]), e2z = _mm256_load_pd(e2[2]);
+
+    // pvec = d x e2
+    const __m256d px = _mm256_sub_pd(_mm256_mul_pd(dy, e2z), _mm256_mul_pd(dz, e2y));
+    const __m256d py = _mm256_sub_pd(_mm256_mul_pd(dz, e2x), _mm256_mul_pd(dx, e2z));
+    const __m256d pz = _mm256_sub_pd(_mm256_mul_pd(dx, e2y), _mm256_mul_pd(dy, e2x));
+
+    __m256d det = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(e1x, px), _mm256_mul_pd(e1y, py)), _mm256_mul_pd(e1z, pz));
+    __m256d mask = _mm256_or_pd(_mm256_cmp_pd(det, _mm256_set1_pd(epsilon), _CMP_GE_OQ),
+                                _mm256_cmp_pd(det, _mm256_set1_pd(-epsilon), _CMP_LE_OQ));
+    det = _mm256_div_pd(_mm256_set1_pd(1.0), det);
+
+    // tvec = o - v0
+    const __m256d tx = _mm256_sub_pd(_mm256_set1_pd(o[0]), _mm256_load_pd(v0[0]));
+    const __m256d ty = _mm256_sub_pd(_mm256_set1_pd(o[1]), _mm256_load_pd(v0[1]));
+    const __m256d tz = _mm256_sub_pd(_mm256_set1_pd(o[2]), _mm256_load_pd(v0[2]));
+
+    const __m256d uu = _mm256_mul_pd(
+            _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(tx, px), _mm256_mul_pd(ty, py)), _mm256_mul_pd(tz, pz)), det);
+    mask = _mm256_and_pd(mask, _mm256_cmp_pd(uu, _mm256_setzero_pd(), _CMP_GE_OQ));
+    mask = _mm256_and_pd(mask, _mm256_cmp_pd(uu, _mm256_set1_pd(1.0), _CMP_LE_OQ));
+
+    // qvec = tvec x e1
+    const __m256d qx = _mm256_sub_pd(_mm256_mul_pd(ty, e1z), _mm256_mul_pd(tz, e1y));
+    const __m256d qy = _mm256_sub_pd(_mm256_mul_pd(tz, e1x), _mm256_mul_pd(tx, e1z));
+    const __m256d qz = _mm256_sub_pd(_mm256_mul_pd(tx, e1y), _mm256_mul_pd(ty, e1x));
+
+    const __m256d vv = _mm256_mul_pd(
+            _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, qx), _mm256_mul_pd(dy, qy)), _mm256_mul_pd(dz, qz)), det);
+    mask = _mm256_and_pd(mask, _mm256_cmp_pd(vv, _mm256_setzero_pd(), _CMP_GE_OQ));
+    mask = _mm256_and_pd(mask, _mm256_cmp_pd(_mm256_add_pd(uu, vv), _mm256_set1_pd(1.0), _CMP_LE_OQ));
+
+    const __m256d tt = _mm256_mul_pd(
+            _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(e2x, qx), _mm256_mul_pd(e2y, qy)), _mm256_mul_pd(e2z, qz)), det);
+    mask = _mm256_and_pd(mask, _mm256_cmp_pd(tt, _mm256_set1_pd(tmin), _CMP_GT_OQ));
+    mask = _mm256_and_pd(mask, _mm256_cmp_pd(tt, _mm256_set1_pd(tmax), _CMP_LT_OQ));
+
+    _mm256_storeu_pd(t, tt);
+    _mm256_storeu_pd(u, uu);
+    _mm256_storeu_pd(v, vv);
+    return _mm256_movemask_pd(mask);
+#elif defined(__SSE2__) || defined(_M_X64)
+    int hits = 0;
+    const __m128d dx = _mm_set1_pd(d[0]), dy = _mm_set1_pd(d[1]), dz = _mm_set1_pd(d[2]);
+    for (int i = 0; i < Size; i += 2) {
+        const __m128d e1x = _mm_load_pd(e1[0] + i), e1y = _mm_load_pd(e1[1] + i), e1z = _mm_load_pd(e1[2] + i);
+        const __m128d e2x = _mm_load_pd(e2[0] + i), e2y = _mm_load_pd(e2[1] + i), e2z = _mm_load_pd(e2[2] + i);
+
+        // pvec = d x e2
+        const __m128d px = _mm_sub_pd(_mm_mul_pd(dy, e2z), _mm_mul_pd(dz, e2y));
+        const __m128d py = _mm_sub_pd(_mm_mul_pd(dz, e2x), _mm_mul_pd(dx, e2z));
+        const __m128d pz = _mm_sub_pd(_mm_mul_pd(dx, e2y), _mm_mul_pd(dy, e2x));
+
+        __m128d det = _mm_add_pd(_mm_add_pd(_mm_mul_pd(e1x, px), _mm_mul_pd(e1y, py)), _mm_mul_pd(e1z, pz));
+        __m128d mask = _mm_or_pd(_mm_cmpge_pd(det, _mm_set1_pd(epsilon)), _mm_cmple_pd(det, _mm_set1_pd(-epsilon)));
+        det = _mm_div_pd(_mm_set1_pd(1.0), det);
+
+        // tvec = o - v0
+        const __m128d tx = _mm_sub_pd(_mm_set1_pd(o[0]), _mm_load_pd(v0[0] + i));
+        const __m128d ty = _mm_sub_pd(_mm_set1_pd(o[1]), _mm_load_pd(v0[1] + i));
+        const __m128d tz = _mm_sub_pd(_mm_set1_pd(o[2]), _mm_load_pd(v0[2] + i));
+
+        const __m128d uu = _mm_mul_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(tx, px), _mm_mul_pd(ty, py)), _mm_mul_pd(tz, pz)),
+                                      det);
+        mask = _mm_and_pd(mask, _mm_cmpge_pd(uu, _mm_setzero_pd()));
+        mask = _mm_and_pd(mask, _mm_cmple_pd(uu, _mm_set1_pd(1.0)));
+
+        // qvec = tvec x e1
+        const __m128d qx = _mm_sub_pd(_mm_mul_pd(ty, e1z), _mm_mul_pd(tz, e1y));
+        const __m128d qy = _mm_sub_pd(_mm_mul_pd(tz, e1x), _mm_mul_pd(tx, e1z));
+        const __m128d qz = _mm_sub_pd(_mm_mul_pd(tx, e1y), _mm_mul_pd(ty, e1x));
+
+        const __m128d vv = _mm_mul_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, qx), _mm_mul_pd(dy, qy)), _mm_mul_pd(dz, qz)),
+                                      det);
+        mask = _mm_and_pd(mask, _mm_cmpge_pd(vv, _mm_setzero_pd()));
+        mask = _mm_and_pd(mask, _mm_cmple_pd(_mm_add_pd(uu, vv), _mm_set1_pd(1.0)));
+
+        const __m128d tt = _mm_mul_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(e2x, qx), _mm_mul_pd(e2y, qy)), _mm_mul_pd(e2z, qz)),
+                                      det);
+        mask = _mm_and_pd(mask, _mm_cmpgt_pd(tt, _mm_set1_pd(tmin)));
+        mask = _mm_and_pd(mask, _mm_cmplt_pd(tt, _mm_set1_pd(tmax)));
+
+        _mm_storeu_pd(t + i, tt);
+        _mm_storeu_pd(u + i, uu);
+        _mm_storeu_pd(v + i, vv);
+        hits |= _mm_movemask_pd(mask) << i;
+    }
+    return hits;
+#else
+    int hits = 0;
+    for (int i = 0; i < Size; i++) {
+        const Vector a(e1[0][i], e1[1][i], e1[2][i]);
+        const Vector b(e2[0][i], e2[1][i], e2[2][i]);
+
+        const Vector pvec = d / b;
+        double det = a * pvec;
+        if ((det > -epsilon) && (det < epsilon))
+            continue;
+        det = 1.0 / det;
+
+        const Vector tvec = o - Vector(v0[0][i], v0[1][i], v0[2][i]);
+        u[i] = (tvec * pvec) * det;
+        if ((u[i] < 0.0) || (u[i] > 1.0))
+            continue;
+
+        const Vector qvec = tvec / a;
+        v[i] = (d * qvec) * det;
+        if ((v[i] < 0.0) || (u[i] + v[i]) > 1.0)
+            continue;
+
+        t[i] = (b * qvec) * det;
+        if ((t[i] > tmin) && (t[i] < tmax))
+            hits |= 1 << i;
+    }
+    return hits;
+#endif
+}
+
+/*!
+\brief Compute the closest intersection between a ray and the triangles of the packet.
+
+\param ray The ray (direction should be of unit length).
+\param tmin Only intersections with a depth greater than tmin are reported.
+\param t Intersection depth, which should be initialized to the maximum depth.
+\param u,v Parametric coordinates of the intersection in the triangle.
+\param i Slot of the intersected triangle.
+*/
+bool TrianglePacket::Intersect(const Ray &ray, double tmin, double &t, double &u, double &v, int &i) const {
+    double tt[Size], uu[Size], vv[Size];
+    const int hits = Intersect(ray, tmin, t, tt, uu, vv);
+    if (hits == 0) {
+        return false;
+    }
+    for (int k = 0; k < Size; k++) {
+        if ((hits & (1 << k)) && tt[k] < t) {
+            t = tt[k];
+            u = uu[k];
+            v = vv[k];
+            i = k;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,97 @@
+// Triangle sinks
+
+#include "trianglesink.h"
+
+/*!
+\class MeshSink trianglesink.h
+\brief Collect the batches into a Mesh, with the same normal and vertex indexes.
+*/
+
+/*!
+\brief Create a sink.
+\param mesh Returned mesh, set when the last batch has been received.
+*/
+MeshSink::MeshSink(Mesh &mesh) : mesh(mesh) {
+}
+
+/*!
+\brief Receive a batch of vertexes.
+\param v Vertexes.
+\param n Normals.
+\param count Number of vertexes.
+*/
+void MeshSink::Vertexes(const Vector *v, const Vector *n, int count) {
+    vertex.insert(vertex.end(), v, v + count);
+    normal.insert(normal.end(), n, n + count);
+}
+
+/*!
+\brief Receive a batch of triangles.
+\param t Vertex indexes, three per triangle.
+\param count Number of triangles.
+*/
+void MeshSink::Triangles(const int *t, int count) {
+    triangle.insert(triangle.end(), t, t + 3 * count);
+}
+
+/*!
+\brief Create the mesh and release the buffers.
+*/
+void MeshSink::Finish() {
+    std::vector<int> normals = triangle;
+    mesh = Mesh(vertex, normal, triangle, normals);
+
+    vertex = std::vector<Vector>();
+    normal = std::vector<Vector>();
+    triangle = std::vector<int>();
+}
+
+/*!
+\class ObjSink trianglesink.h
+\brief Write the batches directly to a file in .obj format, see Mesh::SaveObj().
+
+Vertex, normal and face lines are interleaved, which is valid as faces only refer to vertexes that have
+already been written. Only the file buffer is kept in memory.
+*/
+
+/*!
+\brief Open the file.
+\param url Filename.
+\param name %Mesh name in .obj file.
+*/
+ObjSink::ObjSink(const std::string &url, const std::string &name) : out(url) {
+    out << "g " << name << '\n';
+}
+
+/*!
+\brief Write a batch of vertexes.
+\param v Vertexes.
+\param n Normals.
+\param count Number of vertexes.
+*/
+void ObjSink::Vertexes(const Vector *v, const Vector *n, int count) {
+    for (int i = 0; i < count; i++) {
+        out << "v " << v[i][0] << " " << v[i][1] << " " << v[i][2] << '\n';
+        out << "vn " << n[i][0] << " " << n[i][1] << " " << n[i][2] << '\n';
+    }
+}
+
+/*!
+\brief Write a batch of triangles.
+\param t Vertex indexes, three per triangle.
+\param count Number of triangles.
+*/
+void ObjSink::Triangles(const int *t, int count) {
+    for (int i = 0; i < 3 * count; i += 3) {
+        out << "f " << t[i] + 1 << "//" << t[i] + 1 << " "
+            << t[i + 1] + 1 << "//" << t[i + 1] + 1 << " "
+            << t[i + 2] + 1 << "//" << t[i + 2] + 1 << '\n';
+    }
+}
+
+/*!
+\brief Flush and close the file.
+*/
+void ObjSink::Finish() {
+    out.close();
+}